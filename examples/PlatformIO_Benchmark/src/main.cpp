@@ -0,0 +1,383 @@
+/**
+ * @file main.cpp
+ * @brief microbenchmarks of drawing primitives and Drawables
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * Each case runs in batches, so that short primitives are not dominated by
+ * the clock. A batch takes at least kMinBatchTime and cases run for
+ * --time-ms milliseconds after one warm-up batch. Results are printed as one
+ * row per case with the mean, min and median time per call.
+ *
+ * usage: program [--format csv|json] [--filter TEXT] [--time-ms N]
+ */
+#include <Avatar.h>
+#include <Balloon.h>
+#include <BatteryIcon.h>
+#include <DrawingUtils.hpp>
+#include <Effect.h>
+#include <Eyebrows.hpp>
+#include <Eyes.hpp>
+#include <M5Unified.h>
+#include <Mouths.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <faces/FaceTemplates.hpp>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace m5avatar;
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+const int32_t kWidth = 320;
+const int32_t kHeight = 240;
+const std::chrono::microseconds kMinBatchTime(20);
+
+struct Options {
+  bool json = false;
+  std::string filter;
+  uint32_t timeMs = 20;
+};
+
+struct Result {
+  std::string group;
+  std::string name;
+  std::string params;
+  uint64_t iterations;
+  double mean;    // [nsec]
+  double min;     // [nsec]
+  double median;  // [nsec]
+};
+
+class Bench {
+ private:
+  Options options;
+  std::vector<Result> results;
+
+ public:
+  explicit Bench(const Options &options) : options{options} {}
+
+  void run(const std::string &group, const std::string &name,
+           const std::string &params, const std::function<void()> &f) {
+    std::string id = group + "/" + name + "/" + params;
+    if (!options.filter.empty() &&
+        id.find(options.filter) == std::string::npos) {
+      return;
+    }
+    // calibrate the batch, which also warms up caches
+    uint64_t batch = 1;
+    for (;;) {
+      Clock::time_point start = Clock::now();
+      for (uint64_t i = 0; i < batch; i++) {
+        f();
+      }
+      if (Clock::now() - start >= kMinBatchTime) {
+        break;
+      }
+      batch *= 2;
+    }
+
+    std::vector<double> samples;
+    Clock::time_point end =
+        Clock::now() + std::chrono::milliseconds(options.timeMs);
+    do {
+      Clock::time_point start = Clock::now();
+      for (uint64_t i = 0; i < batch; i++) {
+        f();
+      }
+      std::chrono::duration<double, std::nano> elapsed = Clock::now() - start;
+      samples.push_back(elapsed.count() / batch);
+    } while (Clock::now() < end);
+
+    Result result;
+    result.group = group;
+    result.name = name;
+    result.params = params;
+    result.iterations = batch * samples.size();
+    double total = 0.0;
+    for (double sample : samples) {
+      total += sample;
+    }
+    result.mean = total / samples.size();
+    std::sort(samples.begin(), samples.end());
+    result.min = samples.front();
+    result.median = samples[samples.size() / 2];
+    results.push_back(result);
+  }
+
+  void print() const {
+    if (options.json) {
+      printJson();
+    } else {
+      printCsv();
+    }
+  }
+
+ private:
+  void printCsv() const {
+    printf("group,name,params,iterations,mean_ns,min_ns,median_ns\n");
+    for (const auto &r : results) {
+      printf("%s,%s,\"%s\",%llu,%.1f,%.1f,%.1f\n", r.group.c_str(),
+             r.name.c_str(), r.params.c_str(),
+             static_cast<unsigned long long>(r.iterations),  // NOLINT
+             r.mean, r.min, r.median);
+    }
+  }
+
+  void printJson() const {
+    printf("{\n  \"benchmarks\": [");
+    for (size_t i = 0; i < results.size(); i++) {
+      const Result &r = results[i];
+      printf(
+          "%s\n    {\"group\": \"%s\", \"name\": \"%s\", \"params\": "
+          "\"%s\", \"iterations\": %llu, \"mean_ns\": %.1f, \"min_ns\": "
+          "%.1f, \"median_ns\": %.1f}",
+          i == 0 ? "" : ",", r.group.c_str(), r.name.c_str(),
+          r.params.c_str(),
+          static_cast<unsigned long long>(r.iterations),  // NOLINT
+          r.mean, r.min, r.median);
+    }
+    printf("\n  ]\n}\n");
+  }
+};
+
+std::string format(const char *fmt, ...) {
+  char buffer[128];
+  va_list args;
+  va_start(args, fmt);
+  vsnprintf(buffer, sizeof(buffer), fmt, args);
+  va_end(args);
+  return buffer;
+}
+
+const char *const kExpressions[] = {
+    "neutral", "happy", "angry", "sad",       "doubt",
+    "sleepy",  "smile", "laugh", "surprised", "relax",
+};
+
+// keeps results of pure functions alive
+volatile float sink;
+
+void benchGeometry(Bench *bench) {
+  const float kPoints[][6] = {
+      {0.0f, 0.0f, 10.0f, 10.0f, 20.0f, 0.0f},
+      {-40.0f, 5.0f, 0.0f, -30.0f, 40.0f, 5.0f},
+      {0.0f, 0.0f, 100.0f, 1.0f, 200.0f, 0.0f},
+  };
+  for (const auto &p : kPoints) {
+    bench->run("DrawingUtils", "computeParamsOfCirclePassingThroughThreePoints",
+               format("points=%.0f:%.0f:%.0f:%.0f:%.0f:%.0f", p[0], p[1],
+                      p[2], p[3], p[4], p[5]),
+               [&p]() {
+                 float r, cx, cy;
+                 computeParamsOfCirclePassingThroughThreePoints(
+                     r, cx, cy, p[0], p[1], p[2], p[3], p[4], p[5]);
+                 sink = r + cx + cy;
+               });
+  }
+}
+
+void benchPrimitives(Bench *bench, M5Canvas *canvas) {
+  const uint8_t kThicknesses[] = {2, 4, 8};
+  const float kSpans[] = {20.0f, 60.0f, 120.0f};
+  for (float span : kSpans) {
+    for (uint8_t thickness : kThicknesses) {
+      std::string params = format("span=%.0f thickness=%u", span,
+                                  static_cast<unsigned>(thickness));
+      float x1 = 160.0f - span / 2;
+      float x2 = 160.0f + span / 2;
+      float via_y = 120.0f - span / 4;
+      bench->run("DrawingUtils", "fillArc", params, [=]() {
+        fillArc(canvas, x1, 120.0f, x2, 120.0f, 160.0f, via_y, thickness,
+                0xffff);
+      });
+      bench->run("DrawingUtils", "drawArc", params, [=]() {
+        drawArc(canvas, x1, 120.0f, x2, 120.0f, 160.0f, via_y, thickness,
+                0xffff);
+      });
+    }
+  }
+
+  const float kAngles[] = {0.0f, 0.3f, 1.2f};
+  const uint16_t kSizes[] = {8, 32, 96};
+  for (uint16_t size : kSizes) {
+    for (float angle : kAngles) {
+      std::string params = format("size=%u angle=%.1f",
+                                  static_cast<unsigned>(size), angle);
+      bench->run("DrawingUtils", "fillRotatedRect", params, [=]() {
+        fillRotatedRect(canvas, 160, 120, size, size / 2, angle, 0xffff);
+      });
+      bench->run("DrawingUtils", "fillRectRotatedAround", params, [=]() {
+        fillRectRotatedAround(canvas, 160.0f - size / 2, 120.0f - size / 4,
+                              160.0f + size / 2, 120.0f + size / 4, angle,
+                              160, 100, 0xffff);
+      });
+    }
+  }
+}
+
+struct DrawableEntry {
+  const char *name;
+  Drawable *drawable;
+  BoundingRect rect;
+};
+
+void benchDrawables(Bench *bench, M5Canvas *canvas) {
+  std::unique_ptr<Drawable> drawables[] = {
+      std::unique_ptr<Drawable>(new EllipseEye(16, 16, false)),
+      std::unique_ptr<Drawable>(new ToonEye1(60, 84, false)),
+      std::unique_ptr<Drawable>(new ToonEye2(60, 84, false)),
+      std::unique_ptr<Drawable>(new PinkDemonEye(52, 134, false)),
+      std::unique_ptr<Drawable>(new DoggyEye(false)),
+      std::unique_ptr<Drawable>(new RectMouth(50, 90, 4, 60)),
+      std::unique_ptr<Drawable>(new OmegaMouth()),
+      std::unique_ptr<Drawable>(new ToonMouth1(24, 44, 8, 16)),
+      std::unique_ptr<Drawable>(new DoggyMouth(50, 90, 4, 60)),
+      std::unique_ptr<Drawable>(new EllipseEyebrow(36, 20, false)),
+      std::unique_ptr<Drawable>(new BowEyebrow(64, 10, false)),
+      std::unique_ptr<Drawable>(new RectEyebrow(15, 2, false)),
+      std::unique_ptr<Drawable>(new Effect()),
+      std::unique_ptr<Drawable>(new Balloon()),
+      std::unique_ptr<Drawable>(new BatteryIcon()),
+  };
+  const DrawableEntry kEntries[] = {
+      {"EllipseEye", drawables[0].get(), BoundingRect(93, 90)},
+      {"ToonEye1", drawables[1].get(), BoundingRect(163, 64)},
+      {"ToonEye2", drawables[2].get(), BoundingRect(163, 64)},
+      {"PinkDemonEye", drawables[3].get(), BoundingRect(134, 106)},
+      {"DoggyEye", drawables[4].get(), BoundingRect(103, 80)},
+      {"RectMouth", drawables[5].get(), BoundingRect(148, 163)},
+      {"OmegaMouth", drawables[6].get(), BoundingRect(225, 160)},
+      {"ToonMouth1", drawables[7].get(), BoundingRect(222, 160)},
+      {"DoggyMouth", drawables[8].get(), BoundingRect(168, 163)},
+      {"EllipseEyebrow", drawables[9].get(), BoundingRect(97, 102)},
+      {"BowEyebrow", drawables[10].get(), BoundingRect(50, 64)},
+      {"RectEyebrow", drawables[11].get(), BoundingRect(67, 96)},
+      {"Effect", drawables[12].get(), BoundingRect(0, 0, 320, 240)},
+      {"Balloon", drawables[13].get(), BoundingRect(0, 0, 320, 240)},
+      {"BatteryIcon", drawables[14].get(), BoundingRect(0, 0, 320, 240)},
+  };
+  const float kOpenRatios[] = {0.0f, 0.5f, 1.0f};
+  ColorPalette palette;
+  String text("Hello");
+  for (const auto &entry : kEntries) {
+    for (size_t e = 0; e < sizeof(kExpressions) / sizeof(kExpressions[0]);
+         e++) {
+      for (float ratio : kOpenRatios) {
+        std::string params =
+            format("expression=%s open=%.1f", kExpressions[e], ratio);
+        Gaze gaze(0.5f, -0.5f);
+        DrawContext ctx(static_cast<Expression>(e), 0.5f, &palette, gaze,
+                        ratio, gaze, ratio, ratio, text, 0.0f, 1.0f, 16,
+                        BatteryIconStatus::charging, 50, nullptr);
+        Drawable *drawable = entry.drawable;
+        BoundingRect rect = entry.rect;
+        bench->run("Drawable", entry.name, params, [=, &ctx]() {
+          drawable->draw(canvas, rect, &ctx);
+        });
+      }
+    }
+  }
+}
+
+// draws the whole face every call
+void benchFace(Bench *bench, Avatar *avatar, Face *face, const char *name,
+               float rotation, float scale) {
+  avatar->setRotation(rotation);
+  avatar->setScale(scale);
+  std::string params = format("rotation=%.1f scale=%.1f", rotation, scale);
+  bench->run("Face", name, params, [face, avatar]() {
+    face->invalidate();
+    avatar->draw();
+  });
+}
+
+void benchCompositor(Bench *bench, M5Canvas *canvas) {
+  const float kRotations[] = {0.0f, 0.2f, 0.8f};
+  const float kScales[] = {0.5f, 1.0f, 1.5f};
+  {
+    Face *face = new SimpleFace();
+    Avatar avatar(face);
+    avatar.setOutput(canvas);
+    avatar.setColorDepth(16);
+    for (float rotation : kRotations) {
+      for (float scale : kScales) {
+        // rows are copied without a transform
+        bool identity = rotation == 0.0f && scale == 1.0f;
+        benchFace(bench, &avatar, face,
+                  identity ? "pushRows" : "pushRotateZoom", rotation, scale);
+      }
+    }
+  }
+  {
+    // strips are rasterized only without a transform. the other cases are
+    // the same as above
+    Face *face = new SimpleFace();
+    face->setStripRendering(true);
+    Avatar avatar(face);
+    avatar.setOutput(canvas);
+    avatar.setColorDepth(16);
+    benchFace(bench, &avatar, face, "renderStrips", 0.0f, 1.0f);
+  }
+}
+
+bool parseOptions(int argc, char **argv, Options *options) {
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+      const char *format = argv[++i];
+      if (strcmp(format, "json") == 0) {
+        options->json = true;
+      } else if (strcmp(format, "csv") == 0) {
+        options->json = false;
+      } else {
+        return false;
+      }
+    } else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+      options->filter = argv[++i];
+    } else if (strcmp(argv[i], "--time-ms") == 0 && i + 1 < argc) {
+      options->timeMs = atoi(argv[++i]);
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  if (!parseOptions(argc, argv, &options)) {
+    fprintf(stderr,
+            "usage: %s [--format csv|json] [--filter TEXT] [--time-ms N]\n",
+            argv[0]);
+    return 2;
+  }
+
+  M5Canvas canvas;
+  canvas.setColorDepth(16);
+  if (canvas.createSprite(kWidth, kHeight) == nullptr) {
+    fprintf(stderr, "cannot allocate the canvas\n");
+    return 1;
+  }
+
+  Bench bench(options);
+  benchGeometry(&bench);
+  benchPrimitives(&bench, &canvas);
+  benchDrawables(&bench, &canvas);
+  benchCompositor(&bench, &canvas);
+  bench.print();
+  return 0;
+}
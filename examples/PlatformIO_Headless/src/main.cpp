@@ -0,0 +1,381 @@
+/**
+ * @file main.cpp
+ * @brief headless renderer and golden-image regression suite
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * Every face template is drawn in 16-bit color into offscreen canvases for
+ * each expression with several gazes, eye open ratios, mouth open ratios
+ * and transforms. Each frame is drawn on the reference path (no
+ * optimization) and on three optimized paths:
+ *   sprite  incremental drawing, display list and indexed colors with the
+ *           retained frame sprite
+ *   strips  the same with strip rendering
+ *   cache   incremental drawing and raster caches of eyes without the
+ *           display list, which does not use the caches
+ * The optimized frames must be pixel-exact with the reference frame, and
+ * the reference frame must match the golden frame stored as a hash in
+ * golden/<face>.txt. A face without golden frames fails. The rasterization
+ * time of each path is reported. Frames of the reference and display list
+ * paths must not allocate after the warm-up of the avatar (see
+ * Avatar::getAllocationViolationCount()). Raster cache misses allocate
+ * sprites, so the cache path is not checked.
+ *
+ * usage: program [--update] [--golden DIR] [--dump DIR]
+ *   --update     record the golden frames from the reference path
+ *   --golden DIR directory of golden frames (default: golden)
+ *   --dump DIR   write mismatched frames to DIR as PPM images
+ */
+#include <Avatar.h>
+#include <M5Unified.h>
+#include <faces/BMPFace.h>
+#include <faces/DogFace.h>
+#include <sys/stat.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <faces/FaceTemplates.hpp>
+#include <map>
+#include <string>
+
+using namespace m5avatar;
+
+namespace {
+
+const int32_t kWidth = 320;
+const int32_t kHeight = 240;
+const int kColorDepth = 16;
+const size_t kRasterCacheBudget = 16 * 1024;
+
+struct FaceEntry {
+  const char *name;
+  Face *(*create)();
+};
+
+template <typename T>
+Face *createFace() {
+  return new T();
+}
+
+const FaceEntry kFaces[] = {
+    {"SimpleFace", createFace<SimpleFace>},
+    {"OmegaFace", createFace<OmegaFace>},
+    {"GirlyFace", createFace<GirlyFace>},
+    {"GirlyFace2", createFace<GirlyFace2>},
+    {"ToonFace1", createFace<ToonFace1>},
+    {"PinkDemonFace", createFace<PinkDemonFace>},
+    {"DoggyFace", createFace<DoggyFace>},
+    {"BMPFace", createFace<BMPFace>},
+    {"DogFace", createFace<DogFace>},
+};
+
+const char *const kExpressions[] = {
+    "neutral", "happy", "angry", "sad",       "doubt",
+    "sleepy",  "smile", "laugh", "surprised", "relax",
+};
+
+struct Variant {
+  const char *name;
+  float gazeV;
+  float gazeH;
+  float rightEyeOpenRatio;
+  float leftEyeOpenRatio;
+  float mouthOpenRatio;
+  float rotation;
+  float scale;
+};
+
+// mouth-open draws the red (int TFT_RED) tongue of DoggyFace and DogFace
+const Variant kVariants[] = {
+    {"default", 0.0f, 0.0f, 1.0f, 1.0f, 0.0f, 0.0f, 1.0f},
+    {"gaze-up-left", -1.0f, -1.0f, 1.0f, 1.0f, 0.0f, 0.0f, 1.0f},
+    {"gaze-down-right", 1.0f, 1.0f, 1.0f, 1.0f, 0.0f, 0.0f, 1.0f},
+    {"eyes-half", 0.0f, 0.0f, 0.5f, 0.5f, 0.0f, 0.0f, 1.0f},
+    {"eyes-closed", 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f},
+    {"wink", 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f},
+    {"mouth-half", 0.0f, 0.0f, 1.0f, 1.0f, 0.5f, 0.0f, 1.0f},
+    {"mouth-open", 0.0f, 0.0f, 1.0f, 1.0f, 1.0f, 0.0f, 1.0f},
+    {"rotated", 0.0f, 0.0f, 1.0f, 1.0f, 0.5f, 0.2f, 1.0f},
+    {"scaled", 0.5f, -0.5f, 1.0f, 1.0f, 0.5f, 0.0f, 0.8f},
+};
+
+enum Path { kReference = 0, kSprite, kStrips, kCache, kPathCount };
+
+const char *const kPathNames[] = {"reference", "sprite", "strips", "cache"};
+
+struct Options {
+  bool update = false;
+  std::string golden = "golden";
+  std::string dump;
+};
+
+struct Timing {
+  uint32_t frames = 0;
+  double total = 0.0;  // [usec]
+};
+
+// FNV-1a over the pixels of the canvas
+uint64_t hashFrame(M5Canvas *canvas) {
+  const uint8_t *pixels = static_cast<const uint8_t *>(canvas->getBuffer());
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (uint32_t i = 0; i < canvas->bufferLength(); i++) {
+    hash ^= pixels[i];
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+bool isSameFrame(M5Canvas *a, M5Canvas *b) {
+  return a->bufferLength() == b->bufferLength() &&
+         memcmp(a->getBuffer(), b->getBuffer(), a->bufferLength()) == 0;
+}
+
+void writePpm(M5Canvas *canvas, const std::string &path) {
+  FILE *fp = fopen(path.c_str(), "wb");
+  if (fp == nullptr) {
+    fprintf(stderr, "cannot write %s\n", path.c_str());
+    return;
+  }
+  fprintf(fp, "P6\n%d %d\n255\n", static_cast<int>(kWidth),
+          static_cast<int>(kHeight));
+  for (int32_t y = 0; y < kHeight; y++) {
+    for (int32_t x = 0; x < kWidth; x++) {
+      uint16_t c = canvas->readPixel(x, y);
+      uint8_t rgb[3] = {static_cast<uint8_t>((c >> 11) << 3),
+                        static_cast<uint8_t>(((c >> 5) & 0x3f) << 2),
+                        static_cast<uint8_t>((c & 0x1f) << 3)};
+      fwrite(rgb, 1, sizeof(rgb), fp);
+    }
+  }
+  fclose(fp);
+}
+
+std::map<std::string, uint64_t> loadGolden(const std::string &path,
+                                           bool *found) {
+  std::map<std::string, uint64_t> golden;
+  FILE *fp = fopen(path.c_str(), "r");
+  *found = fp != nullptr;
+  if (fp == nullptr) {
+    return golden;
+  }
+  char name[64];
+  unsigned long long hash;  // NOLINT(runtime/int)
+  while (fscanf(fp, "%63s %llx", name, &hash) == 2) {
+    golden[name] = hash;
+  }
+  fclose(fp);
+  return golden;
+}
+
+bool saveGolden(const std::string &path,
+                const std::map<std::string, uint64_t> &frames) {
+  FILE *fp = fopen(path.c_str(), "w");
+  if (fp == nullptr) {
+    fprintf(stderr, "cannot write %s\n", path.c_str());
+    return false;
+  }
+  for (const auto &frame : frames) {
+    fprintf(fp, "%s %016llx\n", frame.first.c_str(),
+            static_cast<unsigned long long>(frame.second));  // NOLINT
+  }
+  fclose(fp);
+  return true;
+}
+
+void useReferencePath(Face *face) {
+  face->setIncrementalDraw(false);
+  face->setDisplayListEnabled(false);
+  face->setStripRendering(false);
+  face->setIndexedColorDepth(0);
+}
+
+void useOptimizedPath(Face *face, Path path) {
+  face->setRetainSprite(true);
+  face->setIncrementalDraw(true);
+  if (path != kCache) {
+    face->setDisplayListEnabled(true);
+    face->setStripRendering(path == kStrips);
+    face->setIndexedColorDepth(4);
+    return;
+  }
+  // parts are drawn immediately, where eyes are drawn from their caches
+  face->setDisplayListEnabled(false);
+  face->setStripRendering(false);
+  face->setIndexedColorDepth(0);
+  Drawable *eyes[] = {face->getRightEye(), face->getLeftEye()};
+  for (Drawable *eye : eyes) {
+    BaseEye *cached = dynamic_cast<BaseEye *>(eye);
+    if (cached != nullptr) {
+      cached->setRasterCacheBudget(kRasterCacheBudget);
+    }
+  }
+}
+
+void dumpFrame(const Options &options, const FaceEntry &entry,
+               const std::string &name, Path path, M5Canvas *canvas) {
+  if (options.dump.empty()) {
+    return;
+  }
+  std::string file = name;
+  file[file.find('/')] = '-';
+  writePpm(canvas, options.dump + "/" + entry.name + "-" + file + "-" +
+                       kPathNames[path] + ".ppm");
+}
+
+// returns the number of failed frames
+uint32_t runFace(const FaceEntry &entry, const Options &options,
+                 M5Canvas *canvases, Timing *timings) {
+  Avatar *avatars[kPathCount];
+  for (int p = 0; p < kPathCount; p++) {
+    Face *face = entry.create();
+    if (p == kReference) {
+      useReferencePath(face);
+    } else {
+      useOptimizedPath(face, static_cast<Path>(p));
+    }
+    // frames are drawn in order, so incremental drawing is verified as well
+    avatars[p] = new Avatar(face);
+    avatars[p]->setOutput(&canvases[p]);
+    avatars[p]->setColorDepth(kColorDepth);
+    canvases[p].fillScreen(TFT_BLACK);
+  }
+
+  std::string golden_path = options.golden + "/" + entry.name + ".txt";
+  bool has_golden = false;
+  std::map<std::string, uint64_t> golden =
+      loadGolden(golden_path, &has_golden);
+  std::map<std::string, uint64_t> frames;
+  uint32_t failures = 0;
+  if (!has_golden && !options.update) {
+    fprintf(stderr, "%s: no golden frames in %s. record them with --update\n",
+            entry.name, golden_path.c_str());
+    failures++;
+  }
+  for (size_t e = 0; e < sizeof(kExpressions) / sizeof(kExpressions[0]);
+       e++) {
+    for (const auto &variant : kVariants) {
+      std::string name = std::string(kExpressions[e]) + "/" + variant.name;
+      for (int p = 0; p < kPathCount; p++) {
+        Avatar *avatar = avatars[p];
+        avatar->setExpression(static_cast<Expression>(e));
+        avatar->setBreath(0.0f);
+        avatar->setRightGaze(variant.gazeV, variant.gazeH);
+        avatar->setLeftGaze(variant.gazeV, variant.gazeH);
+        avatar->setRightEyeOpenRatio(variant.rightEyeOpenRatio);
+        avatar->setLeftEyeOpenRatio(variant.leftEyeOpenRatio);
+        avatar->setMouthOpenRatio(variant.mouthOpenRatio);
+        avatar->setRotation(variant.rotation);
+        avatar->setScale(variant.scale);
+
+        auto start = std::chrono::steady_clock::now();
+        avatar->draw();
+        std::chrono::duration<double, std::micro> elapsed =
+            std::chrono::steady_clock::now() - start;
+        timings[p].frames++;
+        timings[p].total += elapsed.count();
+      }
+
+      uint64_t hash = hashFrame(&canvases[kReference]);
+      frames[name] = hash;
+      for (int p = kSprite; p < kPathCount; p++) {
+        if (isSameFrame(&canvases[kReference], &canvases[p])) {
+          continue;
+        }
+        failures++;
+        fprintf(stderr, "%s %s: %s path differs from the reference\n",
+                entry.name, name.c_str(), kPathNames[p]);
+        dumpFrame(options, entry, name, static_cast<Path>(p), &canvases[p]);
+        dumpFrame(options, entry, name, kReference, &canvases[kReference]);
+      }
+      if (options.update || !has_golden) {
+        // a missing file is counted once above
+        continue;
+      }
+      auto expected = golden.find(name);
+      if (expected != golden.end() && expected->second == hash) {
+        continue;
+      }
+      failures++;
+      fprintf(stderr, "%s %s: %s\n", entry.name, name.c_str(),
+              expected == golden.end() ? "no golden frame" : "mismatch");
+      dumpFrame(options, entry, name, kReference, &canvases[kReference]);
+    }
+  }
+  for (int p = 0; p < kCache; p++) {
+    uint32_t violations = avatars[p]->getAllocationViolationCount();
+    if (violations != 0) {
+      failures++;
+      fprintf(stderr, "%s: %u frames allocated after the warm-up on the %s "
+              "path\n", entry.name, static_cast<unsigned>(violations),
+              kPathNames[p]);
+    }
+  }
+  for (int p = 0; p < kPathCount; p++) {
+    delete avatars[p];
+  }
+  if (options.update && !saveGolden(golden_path, frames)) {
+    failures++;
+  }
+  return failures;
+}
+
+bool parseOptions(int argc, char **argv, Options *options) {
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--update") == 0) {
+      options->update = true;
+    } else if (strcmp(argv[i], "--golden") == 0 && i + 1 < argc) {
+      options->golden = argv[++i];
+    } else if (strcmp(argv[i], "--dump") == 0 && i + 1 < argc) {
+      options->dump = argv[++i];
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  if (!parseOptions(argc, argv, &options)) {
+    fprintf(stderr, "usage: %s [--update] [--golden DIR] [--dump DIR]\n",
+            argv[0]);
+    return 2;
+  }
+  if (options.update) {
+    mkdir(options.golden.c_str(), 0755);
+  }
+  if (!options.dump.empty()) {
+    mkdir(options.dump.c_str(), 0755);
+  }
+
+  M5Canvas canvases[kPathCount];
+  for (auto &canvas : canvases) {
+    canvas.setColorDepth(kColorDepth);
+    if (canvas.createSprite(kWidth, kHeight) == nullptr) {
+      fprintf(stderr, "cannot allocate the canvas\n");
+      return 1;
+    }
+  }
+
+  uint32_t failures = 0;
+  printf("%-14s %6s %14s %14s %14s %14s %s\n", "face", "frames",
+         "reference[us]", "sprite[us]", "strips[us]", "cache[us]", "result");
+  for (const auto &entry : kFaces) {
+    Timing timings[kPathCount];
+    uint32_t failed = runFace(entry, options, canvases, timings);
+    failures += failed;
+    printf("%-14s %6u %14.1f %14.1f %14.1f %14.1f %s\n", entry.name,
+           static_cast<unsigned>(timings[kReference].frames),
+           timings[kReference].total / timings[kReference].frames,
+           timings[kSprite].total / timings[kSprite].frames,
+           timings[kStrips].total / timings[kStrips].frames,
+           timings[kCache].total / timings[kCache].frames,
+           options.update ? "updated" : failed == 0 ? "ok" : "FAILED");
+  }
+  return failures == 0 ? 0 : 1;
+}
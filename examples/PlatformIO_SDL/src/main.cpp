@@ -8,6 +8,8 @@ Avatar avatar;
 void setup()
 {
   M5.begin();
+  // Chrome trace of the tasks in the native_trace env. no-op otherwise
+  TraceRecorder::writeAtExit("avatar.trace.json");
   avatar.init(); // start drawing
 
   // adjust position
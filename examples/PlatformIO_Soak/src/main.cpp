@@ -0,0 +1,278 @@
+/**
+ * @file main.cpp
+ * @brief long-run soak test of heap usage
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * An avatar is drawn into an offscreen canvas through days of simulated
+ * operation. Expressions, speech, faces, rotation and scale are switched at
+ * random, and the built-in behaviors blink, look around and breathe on a
+ * manual clock. Frames are drawn at the simulated frame rate as fast as
+ * possible. The lowest heap usage of each simulated hour is recorded, and
+ * the test fails when it drifts from the first hour after the warm-up hour.
+ * With M5AVATAR_COUNT_ALLOCATIONS, it also fails when a frame after the
+ * warm-up hour allocates outside the warm-up frames of the avatar (see
+ * Avatar::getAllocationViolationCount()).
+ *
+ * usage: program [--days N] [--fps N] [--seed N] [--max-drift BYTES]
+ *   --days N          simulated days (default: 1)
+ *   --fps N           simulated frames per second (default: 1)
+ *   --seed N          seed of the random events (default: 1)
+ *   --max-drift BYTES allowed growth of the hourly floor (default: 4096)
+ */
+#include <AllocationCounter.hpp>
+#include <Avatar.h>
+#include <M5Unified.h>
+#include <faces/BMPFace.h>
+#include <faces/DogFace.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <faces/FaceTemplates.hpp>
+#include <vector>
+
+using namespace m5avatar;
+
+namespace {
+
+const int32_t kWidth = 320;
+const int32_t kHeight = 240;
+const uint32_t kSecondsPerHour = 3600;
+const uint32_t kExpressionCount = 10;
+
+const char *const kSpeeches[] = {
+    "Hello",
+    "Good morning!",
+    "It is a little bit cold today, isn't it?",
+    "zzz...",
+    "Nice to meet you. I am an avatar on M5Stack.",
+};
+
+struct Options {
+  uint32_t days = 1;
+  uint32_t fps = 1;
+  uint32_t seed = 1;
+  size_t maxDrift = 4096;
+};
+
+// heap usage and frames of a simulated hour
+struct HourStats {
+  size_t floor = SIZE_MAX;
+  size_t peak = 0;
+  // smallest of the hour. SIZE_MAX when the platform does not report it
+  size_t largestFreeBlock = SIZE_MAX;
+  uint32_t allocatingFrames = 0;
+  uint64_t frameBytes = 0;  // allocated by frames
+  double drawTime = 0.0;  // [usec]
+};
+
+// true once per period on average
+bool every(Random *random, uint32_t period_frames) {
+  return period_frames <= 1 || random->below(period_frames) == 0;
+}
+
+std::vector<Face *> createFaces() {
+  return {new SimpleFace(),   new OmegaFace(),     new GirlyFace(),
+          new GirlyFace2(),   new ToonFace1(),     new PinkDemonFace(),
+          new DoggyFace(),    new BMPFace(),       new DogFace()};
+}
+
+// heap in use. all allocators if the platform reports it
+size_t heapUsage(const HeapInfo &info) {
+  return info.usedBytes != 0 ? info.usedBytes : info.liveBytes;
+}
+
+void drawFrame(Avatar *avatar, HourStats *hour) {
+  auto start = std::chrono::steady_clock::now();
+  avatar->draw();
+  std::chrono::duration<double, std::micro> elapsed =
+      std::chrono::steady_clock::now() - start;
+  hour->drawTime += elapsed.count();
+  if (avatar->getFrameAllocationCount() != 0) {
+    hour->allocatingFrames++;
+  }
+  hour->frameBytes += avatar->getFrameAllocatedBytes();
+}
+
+// every face is drawn once, so that buffers grown by the first frames of a
+// face are not counted as drift
+void warmUp(Avatar *avatar, const std::vector<Face *> &faces) {
+  HourStats ignored;
+  for (Face *face : faces) {
+    avatar->setFace(face);
+    for (uint32_t e = 0; e < kExpressionCount; e++) {
+      avatar->setExpression(static_cast<Expression>(e));
+      avatar->setSpeechText(e % 2 == 0 ? "" : kSpeeches[e % 5]);
+      drawFrame(avatar, &ignored);
+    }
+  }
+  avatar->setFace(faces[0]);
+  avatar->setSpeechText("");
+}
+
+void simulateFrame(Avatar *avatar, const std::vector<Face *> &faces,
+                   const Options &options, Random *random) {
+  const uint32_t fps = options.fps;
+  if (every(random, 30 * fps)) {
+    avatar->setExpression(
+        static_cast<Expression>(random->below(kExpressionCount)));
+  }
+  if (every(random, 60 * fps)) {
+    const size_t count = sizeof(kSpeeches) / sizeof(kSpeeches[0]);
+    uint32_t i = random->below(count + 1);
+    avatar->setSpeechText(i == count ? "" : kSpeeches[i]);
+  }
+  if (every(random, 600 * fps)) {
+    avatar->setFace(faces[random->below(faces.size())]);
+  }
+  if (every(random, 300 * fps)) {
+    avatar->setRotation((random->uniform() - 0.5f) * 0.5f);
+    avatar->setScale(0.6f + random->uniform() * 0.6f);
+  }
+  avatar->setMouthOpenRatio(every(random, 3) ? random->uniform() : 0.0f);
+}
+
+bool parseOptions(int argc, char **argv, Options *options) {
+  for (int i = 1; i < argc; i++) {
+    if (i + 1 >= argc) {
+      return false;
+    }
+    uint32_t value = strtoul(argv[i + 1], nullptr, 10);
+    if (strcmp(argv[i], "--days") == 0) {
+      options->days = value;
+    } else if (strcmp(argv[i], "--fps") == 0 && value != 0) {
+      options->fps = value;
+    } else if (strcmp(argv[i], "--seed") == 0) {
+      options->seed = value;
+    } else if (strcmp(argv[i], "--max-drift") == 0) {
+      options->maxDrift = value;
+    } else {
+      return false;
+    }
+    i++;
+  }
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  if (!parseOptions(argc, argv, &options)) {
+    fprintf(stderr,
+            "usage: %s [--days N] [--fps N] [--seed N] "
+            "[--max-drift BYTES]\n",
+            argv[0]);
+    return 2;
+  }
+
+  M5Canvas canvas;
+  canvas.setColorDepth(16);
+  if (canvas.createSprite(kWidth, kHeight) == nullptr) {
+    fprintf(stderr, "cannot allocate the canvas\n");
+    return 1;
+  }
+
+  std::vector<Face *> faces = createFaces();
+  // the events and the behaviors repeat for a seed
+  Random random(options.seed);
+  size_t baseline = 0;
+  size_t maxDrift = 0;
+  uint32_t allocatingFrames = 0;
+  uint32_t violations = 0;
+  {
+    // the avatar is not started. its behaviors are run on the simulated
+    // time below
+    ManualClock clock;
+    Avatar avatar(faces[0]);
+    avatar.setOutput(&canvas);
+    avatar.setClock(&clock);
+    avatar.setRandomSeed(options.seed + 1);
+    warmUp(&avatar, faces);
+
+    const uint32_t hours = options.days * 24;
+    const uint32_t framesPerHour = kSecondsPerHour * options.fps;
+    printf("%6s %10s %10s %12s %9s %10s %10s %9s\n", "hour", "floor[B]",
+           "peak[B]", "largest[B]", "drift[B]", "alloc[fr]", "alloc[B]",
+           "mean[us]");
+    for (uint32_t h = 0; h <= hours; h++) {
+      HourStats hour;
+      for (uint32_t f = 0; f < framesPerHour; f++) {
+        // [msec] since the hour began, so that the frames do not drift
+        uint32_t ms = static_cast<uint64_t>(f) * 1000 / options.fps;
+        clock.set(h * kSecondsPerHour * 1000 + ms);
+        avatar.runBehaviors();
+        simulateFrame(&avatar, faces, options, &random);
+        drawFrame(&avatar, &hour);
+        HeapInfo info = getHeapInfo();
+        size_t used = heapUsage(info);
+        hour.floor = std::min(hour.floor, used);
+        hour.peak = std::max(hour.peak, used);
+        if (info.largestFreeBlock != 0) {
+          hour.largestFreeBlock =
+              std::min(hour.largestFreeBlock, info.largestFreeBlock);
+        }
+      }
+      // hour 0 warms up caches of strings and fonts
+      if (h == 0) {
+        violations = avatar.getAllocationViolationCount();
+      }
+      if (h == 1) {
+        baseline = hour.floor;
+      }
+      long drift = h == 0 ? 0  // NOLINT(runtime/int)
+                          : static_cast<long>(hour.floor) -  // NOLINT
+                                static_cast<long>(baseline);  // NOLINT
+      if (drift > 0 && static_cast<size_t>(drift) > maxDrift) {
+        maxDrift = drift;
+      }
+      if (h > 0) {
+        allocatingFrames += hour.allocatingFrames;
+      }
+      // the largest free block is reported only on ESP32. see HeapInfo
+      char largest[16] = "-";
+      if (hour.largestFreeBlock != SIZE_MAX) {
+        snprintf(largest, sizeof(largest), "%zu", hour.largestFreeBlock);
+      }
+      printf("%6u %10zu %10zu %12s %9ld %10u %10llu %9.1f\n",
+             static_cast<unsigned>(h), hour.floor, hour.peak, largest,
+             drift, static_cast<unsigned>(hour.allocatingFrames),
+             static_cast<unsigned long long>(hour.frameBytes),  // NOLINT
+             hour.drawTime / framesPerHour);
+      fflush(stdout);
+    }
+
+    violations = avatar.getAllocationViolationCount() - violations;
+
+    // the avatar deletes only the face it holds
+    avatar.setFace(faces[0]);
+    for (size_t i = 1; i < faces.size(); i++) {
+      delete faces[i];
+    }
+  }
+
+  HeapInfo info = getHeapInfo();
+  printf("peak operator new: %zu B, frames allocating after warm-up: %u\n",
+         info.peakLiveBytes, static_cast<unsigned>(allocatingFrames));
+  if (!isAllocationCountEnabled()) {
+    printf("build with -DM5AVATAR_COUNT_ALLOCATIONS to count allocations\n");
+  }
+  if (violations != 0) {
+    printf("FAILED: %u frames allocated after the warm-up\n",
+           static_cast<unsigned>(violations));
+    return 1;
+  }
+  if (maxDrift > options.maxDrift) {
+    printf("FAILED: the heap floor drifted by %zu B (max %zu B)\n", maxDrift,
+           options.maxDrift);
+    return 1;
+  }
+  printf("ok: the heap floor drifted by %zu B\n", maxDrift);
+  return 0;
+}
@@ -0,0 +1,133 @@
+/**
+ * @file AllocationCounter.cpp
+ * @brief debug counter of heap allocations
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "AllocationCounter.hpp"
+
+#if defined(ESP_PLATFORM)
+#include <esp_heap_caps.h>
+#elif defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+#ifdef M5AVATAR_COUNT_ALLOCATIONS
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+// per task, so that allocations of other tasks are not counted in a frame
+thread_local uint32_t allocationCount = 0;
+thread_local uint32_t allocatedBytes = 0;
+
+// held by all tasks
+std::atomic<size_t> liveBytes{0};
+std::atomic<size_t> peakLiveBytes{0};
+
+// the size of a block is kept before it, so that delete knows the size
+const size_t kHeaderSize = alignof(std::max_align_t);
+
+void *allocate(size_t size, bool nothrow) {
+  allocationCount++;
+  allocatedBytes += size;
+  void *block = std::malloc(size + kHeaderSize);
+  if (block == nullptr) {
+    if (nothrow) {
+      return nullptr;
+    }
+#if defined(__cpp_exceptions) || defined(__EXCEPTIONS)
+    throw std::bad_alloc();
+#else
+    std::abort();
+#endif
+  }
+  *static_cast<size_t *>(block) = size;
+  size_t live = liveBytes.fetch_add(size) + size;
+  size_t peak = peakLiveBytes.load();
+  while (live > peak && !peakLiveBytes.compare_exchange_weak(peak, live)) {
+  }
+  return static_cast<char *>(block) + kHeaderSize;
+}
+
+void release(void *p) {
+  if (p == nullptr) {
+    return;
+  }
+  void *block = static_cast<char *>(p) - kHeaderSize;
+  liveBytes.fetch_sub(*static_cast<size_t *>(block));
+  std::free(block);
+}
+
+}  // namespace
+
+void *operator new(size_t size) { return allocate(size, false); }
+void *operator new[](size_t size) { return allocate(size, false); }
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+  return allocate(size, true);
+}
+void *operator new[](size_t size, const std::nothrow_t &) noexcept {
+  return allocate(size, true);
+}
+void operator delete(void *p) noexcept { release(p); }
+void operator delete[](void *p) noexcept { release(p); }
+void operator delete(void *p, size_t) noexcept { release(p); }
+void operator delete[](void *p, size_t) noexcept { release(p); }
+
+namespace m5avatar {
+
+uint32_t getAllocationCount() { return allocationCount; }
+
+uint32_t getAllocatedBytes() { return allocatedBytes; }
+
+bool isAllocationCountEnabled() { return true; }
+
+}  // namespace m5avatar
+
+#else
+
+namespace m5avatar {
+
+uint32_t getAllocationCount() { return 0; }
+
+uint32_t getAllocatedBytes() { return 0; }
+
+bool isAllocationCountEnabled() { return false; }
+
+}  // namespace m5avatar
+
+#endif  // M5AVATAR_COUNT_ALLOCATIONS
+
+namespace m5avatar {
+
+HeapInfo getHeapInfo() {
+  HeapInfo info{};
+#if defined(ESP_PLATFORM)
+  info.freeBytes = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+  info.usedBytes = heap_caps_get_total_size(MALLOC_CAP_8BIT) - info.freeBytes;
+  info.minFreeBytes = heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT);
+  info.largestFreeBlock = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+#elif defined(__GLIBC__)
+#if __GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33)
+  struct mallinfo2 mi = mallinfo2();
+#else
+  struct mallinfo mi = mallinfo();
+#endif
+  // large blocks such as sprite buffers are mapped separately
+  info.usedBytes = mi.uordblks + mi.hblkhd;
+  info.freeBytes = mi.fordblks;
+#endif
+#ifdef M5AVATAR_COUNT_ALLOCATIONS
+  info.liveBytes = liveBytes.load();
+  info.peakLiveBytes = peakLiveBytes.load();
+#endif
+  return info;
+}
+
+}  // namespace m5avatar
@@ -0,0 +1,69 @@
+/**
+ * @file AllocationCounter.hpp
+ * @brief debug counter of heap allocations
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef M5AVATAR_ALLOCATION_COUNTER_HPP_
+#define M5AVATAR_ALLOCATION_COUNTER_HPP_
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace m5avatar {
+
+/**
+ * @brief number of operator new calls in the calling task
+ *
+ * Allocations are counted only when the library is built with
+ * M5AVATAR_COUNT_ALLOCATIONS defined (e.g. build_flags =
+ * -DM5AVATAR_COUNT_ALLOCATIONS), which replaces the global operator new.
+ * Buffers allocated by malloc (e.g. sprite buffers of LGFX) are not counted.
+ *
+ * @return uint32_t 0 if counting is disabled
+ */
+uint32_t getAllocationCount();
+
+/**
+ * @brief bytes requested by operator new in the calling task
+ *
+ * Counted like getAllocationCount(). It wraps around; only differences are
+ * meaningful.
+ */
+uint32_t getAllocatedBytes();
+
+/**
+ * @brief allocations are counted in this build
+ */
+bool isAllocationCountEnabled();
+
+/**
+ * @brief state of the heap
+ *
+ * Fields which the platform cannot report are 0. minFreeBytes and
+ * largestFreeBlock are reported only on ESP32; glibc has no cheap way to
+ * find them.
+ */
+struct HeapInfo {
+  // bytes in use by all allocators. ESP32 and glibc
+  size_t usedBytes;
+  // free bytes. ESP32 and glibc (free bytes kept by malloc)
+  size_t freeBytes;
+  // lowest free bytes since boot, i.e. the high-water mark. ESP32
+  size_t minFreeBytes;
+  // largest block which can be allocated at once, i.e. fragmentation. ESP32
+  size_t largestFreeBlock;
+  // bytes held through operator new. M5AVATAR_COUNT_ALLOCATIONS
+  size_t liveBytes;
+  // highest liveBytes
+  size_t peakLiveBytes;
+};
+
+HeapInfo getHeapInfo();
+
+}  // namespace m5avatar
+
+#endif  // M5AVATAR_ALLOCATION_COUNTER_HPP_
@@ -4,29 +4,31 @@
 
 #include "Avatar.h"
 
+#include <atomic>
+
+#include "AllocationCounter.hpp"
+
 #ifndef PI
 #define PI 3.1415926535897932384626433832795
 #endif
 
 namespace m5avatar {
 
-unsigned int seed = 0;
+// frames allowed to allocate, e.g. sprites, display lists and raster caches
+const uint32_t kAllocationWarmUpFrames = 60;
 
-#ifndef rand_r
-#define init_rand() srand(seed)
-#define _rand() rand()
-#else
-#define init_rand() ;
-#define _rand() rand_r(&seed)
-#endif
+// tasks created by start()
+const char *const kLoopNames[] = {"drawLoop", "transferLoop", "facialLoop"};
+// longer than a frame and the timeout of presentFrame() in transferLoop
+const uint32_t kLoopExitTimeout = 1000;  // [msec]
+
+// default seeds of avatars. each avatar blinks on its own
+std::atomic<uint32_t> avatarCount{0};
 
 #ifdef SDL_h_
 #define TaskResult() return 0
-#define TaskDelay(ms) lgfx::delay(ms)
-long random(long howbig) { return std::rand() % howbig; }
 #else
 #define TaskResult() vTaskDelete(NULL)
-#define TaskDelay(ms) vTaskDelay(ms / portTICK_PERIOD_MS)
 #endif
 
 // TODO(meganetaaan): make read-only
@@ -34,124 +36,255 @@ DriveContext::DriveContext(Avatar *avatar) : avatar{avatar} {}
 
 Avatar *DriveContext::getAvatar() { return avatar; }
 
-TaskHandle_t drawTaskHandle;
-
 TaskResult_t drawLoop(void *args) {
   DriveContext *ctx = reinterpret_cast<DriveContext *>(args);
   Avatar *avatar = ctx->getAvatar();
+  M5AVATAR_TRACE_THREAD("drawLoop");
+  avatar->beginFrames();
   // update drawings in the display
   while (avatar->isDrawing()) {
+    M5AVATAR_TRACE_SCOPE("task", "drawLoop");
     if (avatar->isDrawing()) {
       avatar->draw();
     }
-    TaskDelay(10);
+    avatar->waitNextFrame();
+  }
+  avatar->endFrames();
+  avatar->exitTask("drawLoop");
+  TaskResult();
+}
+
+TaskResult_t transferLoop(void *args) {
+  DriveContext *ctx = reinterpret_cast<DriveContext *>(args);
+  Avatar *avatar = ctx->getAvatar();
+  M5AVATAR_TRACE_THREAD("transferLoop");
+  // push frames rendered by drawLoop
+  while (avatar->isDrawing()) {
+    M5AVATAR_TRACE_SCOPE("task", "transferLoop");
+    avatar->presentFrame();
   }
+  avatar->exitTask("transferLoop");
   TaskResult();
 }
 
 TaskResult_t facialLoop(void *args) {
-  int count = 0;
   DriveContext *ctx = reinterpret_cast<DriveContext *>(args);
   Avatar *avatar = ctx->getAvatar();
-  uint32_t saccade_interval = 1000;
-  uint32_t blink_interval = 1000;
-  unsigned long last_saccade_millis = 0;
-  unsigned long last_blink_millis = 0;
-  bool eye_open = true;
-  float vertical = 0.0f;
-  float horizontal = 0.0f;
-  float breath = 0.0f;
-  init_rand();
+  M5AVATAR_TRACE_THREAD("facialLoop");
+  avatar->beginBehaviors();
   // update facial internal state
   while (avatar->isDrawing()) {
-    if ((lgfx::millis() - last_saccade_millis) > saccade_interval) {
-      vertical = _rand() / (RAND_MAX / 2.0) - 1;
-      horizontal = _rand() / (RAND_MAX / 2.0) - 1;
-      avatar->setRightGaze(vertical, horizontal);
-      avatar->setLeftGaze(vertical, horizontal);
-      saccade_interval = 500 + 100 * random(20);
-      last_saccade_millis = lgfx::millis();
-    }
+    M5AVATAR_TRACE_SCOPE("task", "facialLoop");
+    avatar->waitForBehaviors(avatar->runBehaviors());
+  }
+  avatar->endBehaviors();
+  avatar->exitTask("facialLoop");
+  TaskResult();
+}
 
-    if (avatar->getIsAutoBlink()) {
-      if ((lgfx::millis() - last_blink_millis) > blink_interval) {
-        if (eye_open) {
-          avatar->setEyeOpenRatio(1.0f);
-          blink_interval = 2500 + 100 * random(20);
-        } else {
-          avatar->setEyeOpenRatio(0.0f);
-          blink_interval = 300 + 10 * random(20);
-        }
-        eye_open = !eye_open;
-        last_blink_millis = lgfx::millis();
-      }
-    }
+namespace {
+
+FacialState initialState() {
+  FacialState state;
+  state.expression = Expression::kNeutral;
+  state.breath = 0;
+  state.rightEyeOpenRatio = 1.0f;
+  state.rightGazeV = 1.0f;
+  state.rightGazeH = 1.0f;
+  state.leftEyeOpenRatio = 1.0f;
+  state.leftGazeV = 1.0f;
+  state.leftGazeH = 1.0f;
+  state.mouthOpenRatio = 0;
+  state.rotation = 0;
+  state.scale = 1;
+  state.palette = ColorPalette();
+  state.colorDepth = 1;
+  state.batteryIconStatus = BatteryIconStatus::invisible;
+  state.batteryLevel = 0;
+  state.speechFont = nullptr;
+  return state;
+}
+
+// breath cycle of the built-in behavior
+const uint32_t kBreathPeriod = 3300;  // [msec]
+const uint32_t kBreathInterval = 33;  // [msec]
+
+uint32_t saccade(void *arg) {
+  Avatar *avatar = reinterpret_cast<Avatar *>(arg);
+  Random *random = avatar->getRandom();
+  float vertical = random->uniform(-1.0f, 1.0f);
+  float horizontal = random->uniform(-1.0f, 1.0f);
+  avatar->setRightGaze(vertical, horizontal);
+  avatar->setLeftGaze(vertical, horizontal);
+  return 500 + 100 * random->below(20);
+}
 
-    count = (count + 1) % 100;
-    breath = sin(count * 2 * PI / 100.0);
-    avatar->setBreath(breath);
-    TaskDelay(33);  // approx. 30fps
+uint32_t blink(void *arg) {
+  Avatar *avatar = reinterpret_cast<Avatar *>(arg);
+  Random *random = avatar->getRandom();
+  if (avatar->getRightEyeOpenRatio() > 0.0f) {
+    avatar->setEyeOpenRatio(0.0f);
+    return 300 + 10 * random->below(20);
   }
-  TaskResult();
+  avatar->setEyeOpenRatio(1.0f);
+  return 2500 + 100 * random->below(20);
+}
+
+uint32_t breathe(void *arg) {
+  Avatar *avatar = reinterpret_cast<Avatar *>(arg);
+  uint32_t phase = avatar->getClock()->now() % kBreathPeriod;
+  avatar->setBreath(sinf(2.0f * PI * phase / kBreathPeriod));
+  return kBreathInterval;
 }
 
+}  // namespace
+
 Avatar::Avatar() : Avatar(new Face()) {}
 
 Avatar::Avatar(Face *face)
     : face{face},
       _isDrawing{false},
-      expression{Expression::kNeutral},
-      breath{0},
-      leftEyeOpenRatio_{1.0f},
-      leftGazeH_{1.0f},
-      leftGazeV_{1.0f},
-      rightEyeOpenRatio_{1.0f},
-      rightGazeH_{1.0f},
-      rightGazeV_{1.0f},
-      isAutoBlink_{true},
-      mouthOpenRatio{0},
-      rotation{0},
-      scale{1},
-      palette{ColorPalette()},
-      speechText{""},
-      colorDepth{1},
-      batteryIconStatus{BatteryIconStatus::invisible} {}
-
-Avatar::~Avatar() { delete face; }
-
-void Avatar::setFace(Face *face) { this->face = face; }
-
-Face *Avatar::getFace() const { return face; }
-
-void Avatar::addTask(TaskFunction_t f, const char *name,
+      state{initialState()},
+      speechText{std::make_shared<const String>("")},
+      runing_in_x_task_{false},
+      frameCount{0},
+      warmUpRequest{false},
+      warmUpVersion{0},
+      frameAllocations{0},
+      frameAllocatedBytes{0},
+      allocationViolations{0},
+#ifdef M5AVATAR_FRAME_STATS
+      frameStats{},
+      frameStatsInterval{0},
+      lastFrameStatsDump{0},
+#endif
+      scheduler{},
+      skipUnchangedFrames{true},
+      drawnVersion{UINT32_MAX},
+      behaviors{},
+      clock{RealClock::getInstance()},
+      random{avatarCount.fetch_add(1)},
+      drawSignal{},
+      facialSignal{},
+      tasks{},
+      pipelined{false},
+      renderCore{APP_CPU_NUM},
+      renderPriority{1},
+      transferCore{PRO_CPU_NUM},
+      transferPriority{1},
+      output{&M5.Display},
+      renderer{nullptr} {
+  uint32_t now = clock->now();
+  behaviors.add("saccade", saccade, this, now, 1000);
+  behaviors.add("blink", blink, this, now, 1000);
+  behaviors.add("breath", breathe, this, now);
+  face->setFrameStats(getFrameStats());
+}
+
+Avatar::~Avatar() {
+  // the loops use the face and the avatar until they exit
+  stop();
+  if (!waitForLoops(kLoopExitTimeout)) {
+    M5_LOGE("tasks of the avatar are deleted while running");
+  }
+  delete face.load();
+}
+
+void Avatar::setFace(Face *face) {
+  if (pipelined && !face->isPipelined()) {
+    // before the transfer task sees the face
+    face->setPipelined(true);
+  }
+  if (face->getOutput() != output) {
+    face->setOutput(output);
+  }
+  face->setFrameStats(getFrameStats());
+  this->face.store(face);
+  // the face allocates its buffers in the first frames
+  restartWarmUp();
+  requestRedraw();
+}
+
+Face *Avatar::getFace() const { return face.load(); }
+
+void Avatar::setOutput(LovyanGFX *output) {
+  this->output = output;
+  getFace()->setOutput(output);
+  restartWarmUp();
+  requestRedraw();
+}
+
+LovyanGFX *Avatar::getOutput() const { return output; }
+
+void Avatar::setClock(Clock *clock) {
+  if (clock == nullptr) {
+    clock = RealClock::getInstance();
+  }
+  behaviors.rebase(this->clock->now(), clock->now());
+  this->clock = clock;
+  // the facial task sleeps on the previous clock
+  facialSignal.notify();
+}
+
+Clock *Avatar::getClock() const { return clock; }
+
+Random *Avatar::getRandom() { return &random; }
+
+void Avatar::setRandomSeed(uint32_t seed) { random.seed(seed); }
+
+void Avatar::setRenderScheduler(RenderScheduler *renderer) {
+  if (_isDrawing) {
+    M5_LOGE("call setRenderScheduler() before start()");
+    return;
+  }
+  this->renderer = renderer;
+}
+
+RenderScheduler *Avatar::getRenderScheduler() const { return renderer; }
+
+bool Avatar::addTask(TaskFunction_t f, const char *name,
                      const uint32_t stack_size, UBaseType_t priority,
                      TaskHandle_t *const task_handle,
                      const BaseType_t core_id) {
-  DriveContext *ctx = new DriveContext(this);
-#ifdef SDL_h_
-  if (task_handle == NULL) {
-    SDL_CreateThreadWithStackSize(f, name, stack_size, ctx);
-  } else {
-    *task_handle = SDL_CreateThreadWithStackSize(f, name, stack_size, ctx);
+  TaskHandle_t handle = tasks.add(f, name, stack_size, priority, core_id,
+                                  new DriveContext(this));
+  if (task_handle != NULL) {
+    *task_handle = handle;
   }
-#else
-  // TODO(meganetaaan): set a task handler
-  xTaskCreateUniversal(f,           /* Function to implement the task */
-                       name,        /* Name of the task */
-                       stack_size,  /* Stack size in words */
-                       ctx,         /* Task input parameter */
-                       priority,    /* Priority of the task */
-                       task_handle, /* Task handle. */
-                       core_id);    /* Core No*/
-#endif
+  return handle != NULL;
 }
 
+bool Avatar::removeTask(const char *name) { return tasks.remove(name); }
+
+std::vector<TaskInfo> Avatar::getTasks() { return tasks.getTasks(); }
+
+void Avatar::exitTask(const char *name) { tasks.exit(name); }
+
 void Avatar::init(int colorDepth) {
   // for compatibility with older version
   start(colorDepth);
 }
 
-void Avatar::stop() { _isDrawing = false; }
+void Avatar::stop() {
+  _isDrawing = false;
+  if (renderer != nullptr) {
+    renderer->remove(this);
+  }
+  // a suspended draw task cannot exit
+  resume();
+  wakeDrawTask();
+  facialSignal.notify();
+  // a loop cannot wait for itself. start() waits for it instead
+  if (tasks.isCurrent()) {
+    return;
+  }
+  if (!waitForLoops(kLoopExitTimeout)) {
+    M5_LOGE("tasks of the avatar did not exit");
+    return;
+  }
+  // nothing to wake until start()
+  this->runing_in_x_task_ = false;
+}
 
 /**
  * @brief update drawings in the display and facial parameters
@@ -163,46 +296,31 @@ void Avatar::update() {
   this->updateFacialParameters();
 }
 
-void Avatar::updateFacialParameters() {
-  static unsigned long mill_sec = 0;
-  static unsigned long last_saccade_millis = 0;
-  static unsigned long last_blink_millis = 0;
-  static uint32_t saccade_interval = 1000;  // [msec]
-  static uint32_t blink_interval = 1000;
-  static bool eye_open = true;
+void Avatar::updateFacialParameters() { runBehaviors(); }
 
-  mill_sec = millis();
+uint32_t Avatar::runBehaviors() { return behaviors.run(clock->now()); }
 
-  float vertical = 0.0f;
-  float horizontal = 0.0f;
-  float breath = 0.0f;
+void Avatar::beginBehaviors() { facialSignal.bind(); }
 
-  if ((mill_sec - last_saccade_millis) > saccade_interval) {
-    vertical = _rand() / (RAND_MAX / 2.0f) - 1.0f;
-    horizontal = _rand() / (RAND_MAX / 2.0f) - 1.0f;
-    this->setRightGaze(vertical, horizontal);
-    this->setLeftGaze(vertical, horizontal);
-    saccade_interval = 500 + 100 * random(20);
-    last_saccade_millis = mill_sec;
-  }
+void Avatar::endBehaviors() { facialSignal.unbind(); }
 
-  if ((this->getIsAutoBlink()) &&
-      ((mill_sec - last_blink_millis) > blink_interval)) {
-    if (eye_open) {
-      this->setEyeOpenRatio(1.0f);
-      blink_interval = 2500 + 100 * random(20);
-    } else {
-      this->setEyeOpenRatio(0.0f);
-      blink_interval = 300 + 10 * random(20);
-    }
-    eye_open = !eye_open;
-    last_blink_millis = mill_sec;
-  }
+void Avatar::waitForBehaviors(uint32_t ms) {
+  // woken early when behaviors are added or removed
+  facialSignal.wait(ms == BehaviorScheduler::kNoneDue ? TaskSignal::kForever
+                                                      : clock->toRealTime(ms));
+}
+
+bool Avatar::addBehavior(const char *name, BehaviorFunction function,
+                         void *arg, uint32_t delay_ms) {
+  bool added = behaviors.add(name, function, arg, clock->now(), delay_ms);
+  facialSignal.notify();
+  return added;
+}
 
-  // update breath
-  // 0.2 Hz
-  breath = sinf(0.2f * 2.0f * PI * (mill_sec / 1000.0f));
-  this->setBreath(breath);
+bool Avatar::removeBehavior(const char *name) {
+  bool removed = behaviors.remove(name);
+  facialSignal.notify();
+  return removed;
 }
 
 void Avatar::suspend() {
@@ -210,7 +328,10 @@ void Avatar::suspend() {
     return;
   }
 #ifndef SDL_h_
-  vTaskSuspend(drawTaskHandle);
+  TaskHandle_t handle = tasks.getHandle("drawLoop");
+  if (handle != NULL) {
+    vTaskSuspend(handle);
+  }
 #endif
 }
 
@@ -219,161 +340,413 @@ void Avatar::resume() {
     return;
   }
 #ifndef SDL_h_
-  vTaskResume(drawTaskHandle);
+  TaskHandle_t handle = tasks.getHandle("drawLoop");
+  if (handle != NULL) {
+    vTaskResume(handle);
+  }
 #endif
 }
 
+bool Avatar::waitForLoops(uint32_t timeout_ms) {
+  uint32_t start = lgfx::millis();
+  for (const char *name : kLoopNames) {
+    while (tasks.contains(name)) {
+      if (lgfx::millis() - start >= timeout_ms) {
+        return false;
+      }
+      lgfx::delay(1);
+    }
+  }
+  return true;
+}
+
 void Avatar::start(int colorDepth) {
   // if the task already started, don't create another task;
   if (_isDrawing) return;
+  // loops stopped by stop() exit when they wake up
+  if (!waitForLoops(kLoopExitTimeout)) {
+    M5_LOGE("tasks of the avatar are still running");
+    return;
+  }
   _isDrawing = true;
 
-  this->colorDepth = colorDepth;
-  DriveContext *ctx = new DriveContext(this);
+  setColorDepth(colorDepth);
   this->runing_in_x_task_ = true;
-#ifdef SDL_h_
-  drawTaskHandle =
-      SDL_CreateThreadWithStackSize(drawLoop, "drawLoop", 2048, ctx);
-  SDL_CreateThreadWithStackSize(facialLoop, "facialLoop", 1024, ctx);
+  bool started = true;
+  if (renderer != nullptr && pipelined) {
+    M5_LOGE("a pipelined avatar is drawn by its own tasks");
+  }
+  if (renderer != nullptr && !pipelined) {
+    started = renderer->add(this);
+  } else {
+    if (pipelined) {
+      if (!getFace()->isPipelined()) {
+        getFace()->setPipelined(true);
+      }
+      started = addTask(transferLoop, "transferLoop", 2048, transferPriority,
+                        NULL, transferCore);
+    }
+    started = started &&
+              addTask(drawLoop, "drawLoop", 2048, renderPriority, NULL,
+                      renderCore);
+  }
+  started = started &&
+            addTask(facialLoop, "facialLoop", 1024, 2, NULL, APP_CPU_NUM);
+  if (!started) {
+    // loops already created exit by themselves
+    M5_LOGE("failed to start the avatar");
+    stop();
+  }
+}
+
+void Avatar::setPipelined(bool enabled, BaseType_t render_core,
+                          UBaseType_t render_priority,
+                          BaseType_t transfer_core,
+                          UBaseType_t transfer_priority) {
+  if (_isDrawing) {
+    M5_LOGE("call setPipelined() before start()");
+    return;
+  }
+  pipelined = enabled;
+  renderCore = render_core;
+  renderPriority = render_priority;
+  transferCore = transfer_core;
+  transferPriority = transfer_priority;
+  if (!enabled && getFace()->isPipelined()) {
+    getFace()->setPipelined(false);
+  }
+}
+
+bool Avatar::isPipelined() { return pipelined; }
+
+void Avatar::presentFrame() {
+  // the timeout lets the loop notice stop()
+  getFace()->presentFrame(100);
+}
+
+void Avatar::draw() {
+#ifdef M5AVATAR_FRAME_STATS
+  // before the timer, so that printing is not counted in a frame
+  dumpFrameStats();
+#endif
+  M5AVATAR_TIME_STAGE(&frameStats, FrameStage::kFrame);
+  uint32_t allocations = getAllocationCount();
+  uint32_t allocatedBytes = getAllocatedBytes();
+  M5AVATAR_STAGE_BEGIN(context_start);
+  // read the version first. a change during load() is drawn in the next frame
+  drawnVersion = state.getVersion();
+  // one snapshot per frame. setters may run while the frame is drawn
+  FacialState s = state.load();
+  // keep the text alive while the frame is drawn
+  std::shared_ptr<const String> text = std::atomic_load(&this->speechText);
+  Gaze rightGaze = Gaze(s.rightGazeV, s.rightGazeH);
+  Gaze leftGaze = Gaze(s.leftGazeV, s.leftGazeH);
+  DrawContext ctx(s.expression, s.breath, &s.palette, rightGaze,
+                  s.rightEyeOpenRatio, leftGaze, s.leftEyeOpenRatio,
+                  s.mouthOpenRatio, *text, s.rotation, s.scale, s.colorDepth,
+                  s.batteryIconStatus, s.batteryLevel, s.speechFont);
+  M5AVATAR_STAGE_END(&frameStats, FrameStage::kContext, context_start);
+  // one face per frame. setFace() may switch it while the frame is drawn
+  getFace()->draw(&ctx);
+
+  frameAllocations = getAllocationCount() - allocations;
+  frameAllocatedBytes = getAllocatedBytes() - allocatedBytes;
+  uint32_t version = warmUpRequest.getVersion();
+  if (version != warmUpVersion) {
+    warmUpVersion = version;
+    frameCount = 0;
+  }
+  if (frameCount < kAllocationWarmUpFrames) {
+    frameCount++;
+  } else if (frameAllocations != 0) {
+    // e.g. a miss of a raster cache. the next frames settle again
+    M5_LOGW("%u heap allocations (%u bytes) in a frame",
+            static_cast<unsigned>(frameAllocations),
+            static_cast<unsigned>(frameAllocatedBytes));
+    allocationViolations++;
+    frameCount = 0;
+  }
+}
+
+void Avatar::restartWarmUp() {
+  // only the version is read
+  warmUpRequest.store(true);
+}
+
+uint32_t Avatar::getFrameAllocationCount() { return frameAllocations; }
+
+uint32_t Avatar::getFrameAllocatedBytes() { return frameAllocatedBytes; }
+
+uint32_t Avatar::getAllocationViolationCount() {
+  return allocationViolations;
+}
+
+#ifdef M5AVATAR_FRAME_STATS
+FrameStats *Avatar::getFrameStats() { return &frameStats; }
+
+void Avatar::setFrameStatsDump(uint32_t interval_ms) {
+  frameStatsInterval = interval_ms;
+  lastFrameStatsDump = lgfx::millis();
+}
+
+void Avatar::dumpFrameStats() {
+  if (frameStatsInterval == 0) {
+    return;
+  }
+  uint32_t now = lgfx::millis();
+  if (now - lastFrameStatsDump < frameStatsInterval) {
+    return;
+  }
+  lastFrameStatsDump = now;
+  frameStats.dump();
+  frameStats.reset();
+}
 #else
-  // TODO(meganetaaan): keep handle of these tasks
-  xTaskCreateUniversal(drawLoop,        /* Function to implement the task */
-                       "drawLoop",      /* Name of the task */
-                       2048,            /* Stack size in words */
-                       ctx,             /* Task input parameter */
-                       1,               /* Priority of the task */
-                       &drawTaskHandle, /* Task handle. */
-                       APP_CPU_NUM);
-
-  xTaskCreateUniversal(facialLoop,   /* Function to implement the task */
-                       "facialLoop", /* Name of the task */
-                       1024,         /* Stack size in words */
-                       ctx,          /* Task input parameter */
-                       2,            /* Priority of the task */
-                       NULL,         /* Task handle. */
-                       APP_CPU_NUM);
+FrameStats *Avatar::getFrameStats() { return nullptr; }
+
+void Avatar::setFrameStatsDump(uint32_t interval_ms) {}
 #endif
+
+void Avatar::setTargetFps(uint32_t fps, bool adaptive, uint32_t min_fps) {
+  scheduler.setTargetFps(fps);
+  scheduler.setAdaptive(adaptive, min_fps);
 }
 
-void Avatar::draw() {
-  Gaze rightGaze = Gaze(this->rightGazeV_, this->rightGazeV_);
-  Gaze leftGaze = Gaze(this->leftGazeV_, this->leftGazeH_);
-  DrawContext *ctx = new DrawContext(
-      this->expression, this->breath, &this->palette, rightGaze,
-      this->rightEyeOpenRatio_, leftGaze, this->leftEyeOpenRatio_,
-      this->mouthOpenRatio, this->speechText, this->rotation, this->scale,
-      this->colorDepth, this->batteryIconStatus, this->batteryLevel,
-      this->speechFont);
-  face->draw(ctx);
-  delete ctx;
+uint32_t Avatar::getTargetFps() { return scheduler.getTargetFps(); }
+
+const FrameScheduler *Avatar::getFrameScheduler() const { return &scheduler; }
+
+void Avatar::beginFrames() {
+  drawSignal.bind();
+  scheduler.begin();
+}
+
+void Avatar::endFrames() { drawSignal.unbind(); }
+
+void Avatar::waitNextFrame() {
+  scheduler.wait();
+  if (!skipUnchangedFrames) {
+    return;
+  }
+  bool idle = false;
+  while (_isDrawing && state.getVersion() == drawnVersion) {
+    waitForChange();
+    idle = true;
+  }
+  if (idle) {
+    // deadlines passed while sleeping are not missed
+    scheduler.begin();
+  }
+}
+
+void Avatar::waitForChange() { drawSignal.wait(); }
+
+void Avatar::wakeDrawTask() {
+  if (!this->runing_in_x_task_) {
+    return;
+  }
+  if (renderer != nullptr) {
+    renderer->notify();
+  }
+  drawSignal.notify();
+}
+
+void Avatar::setSkipUnchangedFrames(bool b) {
+  skipUnchangedFrames = b;
+  wakeDrawTask();
+}
+
+bool Avatar::getSkipUnchangedFrames() { return skipUnchangedFrames; }
+
+void Avatar::requestRedraw() {
+  // an empty write bumps the version of the state
+  modifyState([](FacialState &) {});
+}
+
+bool Avatar::needsRedraw() {
+  return !skipUnchangedFrames || state.getVersion() != drawnVersion;
 }
 
 bool Avatar::isDrawing() { return _isDrawing; }
 
 void Avatar::setExpression(Expression expression) {
-  suspend();
-  this->expression = expression;
-  resume();
+  modifyState([expression](FacialState &s) { s.expression = expression; });
 }
 
-Expression Avatar::getExpression() { return this->expression; }
+Expression Avatar::getExpression() { return state.load().expression; }
 
-void Avatar::setBreath(float breath) { this->breath = breath; }
+void Avatar::setBreath(float breath) {
+  modifyState([breath](FacialState &s) { s.breath = breath; });
+}
 
-float Avatar::getBreath() { return this->breath; }
+float Avatar::getBreath() { return state.load().breath; }
 
-void Avatar::setRotation(float radian) { this->rotation = radian; }
+void Avatar::setRotation(float radian) {
+  modifyState([radian](FacialState &s) { s.rotation = radian; });
+}
 
-void Avatar::setScale(float scale) { this->scale = scale; }
+void Avatar::setScale(float scale) {
+  bool changed = false;
+  modifyState([scale, &changed](FacialState &s) {
+    changed = s.scale != scale;
+    s.scale = scale;
+  });
+  if (changed) {
+    // buffers of the transformed region are resized
+    restartWarmUp();
+  }
+}
 
 void Avatar::setPosition(int top, int left) {
   this->getFace()->getBoundingRect()->setPosition(top, left);
+  restartWarmUp();
+  requestRedraw();
 }
 
-void Avatar::setColorPalette(ColorPalette cp) { palette = cp; }
+void Avatar::setColorPalette(ColorPalette cp) {
+  modifyState([&cp](FacialState &s) { s.palette = cp; });
+}
 
-ColorPalette Avatar::getColorPalette(void) const { return this->palette; }
+ColorPalette Avatar::getColorPalette(void) const {
+  return state.load().palette;
+}
 
-void Avatar::setMouthOpenRatio(float ratio) { this->mouthOpenRatio = ratio; }
+void Avatar::setMouthOpenRatio(float ratio) {
+  modifyState([ratio](FacialState &s) { s.mouthOpenRatio = ratio; });
+}
 
 void Avatar::setEyeOpenRatio(float ratio) {
-  setRightEyeOpenRatio(ratio);
-  setLeftEyeOpenRatio(ratio);
+  // both eyes in one write so that they are drawn in the same frame
+  modifyState([ratio](FacialState &s) {
+    s.rightEyeOpenRatio = ratio;
+    s.leftEyeOpenRatio = ratio;
+  });
 }
 
 void Avatar::setLeftEyeOpenRatio(float ratio) {
-  this->leftEyeOpenRatio_ = ratio;
+  modifyState([ratio](FacialState &s) { s.leftEyeOpenRatio = ratio; });
 }
 
-float Avatar::getLeftEyeOpenRatio() { return this->leftEyeOpenRatio_; }
+float Avatar::getLeftEyeOpenRatio() { return state.load().leftEyeOpenRatio; }
 
 void Avatar::setRightEyeOpenRatio(float ratio) {
-  this->rightEyeOpenRatio_ = ratio;
+  modifyState([ratio](FacialState &s) { s.rightEyeOpenRatio = ratio; });
 }
 
-float Avatar::getRightEyeOpenRatio() { return this->rightEyeOpenRatio_; }
+float Avatar::getRightEyeOpenRatio() { return state.load().rightEyeOpenRatio; }
 
-void Avatar::setIsAutoBlink(bool b) { this->isAutoBlink_ = b; }
+void Avatar::setIsAutoBlink(bool b) {
+  if (b) {
+    addBehavior("blink", blink, this);
+  } else {
+    removeBehavior("blink");
+  }
+}
 
-bool Avatar::getIsAutoBlink() { return this->isAutoBlink_; }
+bool Avatar::getIsAutoBlink() { return behaviors.contains("blink"); }
+
+void Avatar::setIsAutoBreath(bool b) {
+  if (b) {
+    addBehavior("breath", breathe, this);
+  } else {
+    removeBehavior("breath");
+    setBreath(0.0f);
+  }
+}
+
+bool Avatar::getIsAutoBreath() { return behaviors.contains("breath"); }
+
+void Avatar::setIsAutoSaccade(bool b) {
+  if (b) {
+    addBehavior("saccade", saccade, this);
+  } else {
+    removeBehavior("saccade");
+  }
+}
+
+bool Avatar::getIsAutoSaccade() { return behaviors.contains("saccade"); }
 
 void Avatar::setRightGaze(float vertical, float horizontal) {
-  this->rightGazeV_ = vertical;
-  this->rightGazeH_ = horizontal;
+  modifyState([vertical, horizontal](FacialState &s) {
+    s.rightGazeV = vertical;
+    s.rightGazeH = horizontal;
+  });
 }
 
 void Avatar::getRightGaze(float *vertical, float *horizontal) {
-  *vertical = this->rightGazeV_;
-  *horizontal = this->rightGazeH_;
+  FacialState s = state.load();
+  *vertical = s.rightGazeV;
+  *horizontal = s.rightGazeH;
 }
 
 void Avatar::setLeftGaze(float vertical, float horizontal) {
-  this->leftGazeV_ = vertical;
-  this->leftGazeH_ = horizontal;
+  modifyState([vertical, horizontal](FacialState &s) {
+    s.leftGazeV = vertical;
+    s.leftGazeH = horizontal;
+  });
 }
 
 void Avatar::getLeftGaze(float *vertical, float *horizontal) {
-  *vertical = this->leftGazeV_;
-  *horizontal = this->leftGazeH_;
+  FacialState s = state.load();
+  *vertical = s.leftGazeV;
+  *horizontal = s.leftGazeH;
 }
 
 void Avatar::getGaze(float *vertical, float *horizontal) {
-  *vertical = 0.5f * this->leftGazeV_ + 0.5f * this->rightGazeV_;
-  *horizontal = 0.5f * this->leftGazeH_ + 0.5f * this->rightGazeH_;
+  FacialState s = state.load();
+  *vertical = 0.5f * s.leftGazeV + 0.5f * s.rightGazeV;
+  *horizontal = 0.5f * s.leftGazeH + 0.5f * s.rightGazeH;
 }
 
 void Avatar::setSpeechText(const char *speechText) {
-  this->speechText = String(speechText);
+  // the draw task may still use the old text. it is freed with the last
+  // reference
+  std::atomic_store(&this->speechText,
+                    std::make_shared<const String>(speechText));
+  // the balloon measures the first text with a new canvas
+  restartWarmUp();
+  requestRedraw();
 }
 
 void Avatar::setSpeechFont(const lgfx::IFont *speechFont) {
-  this->speechFont = speechFont;
+  modifyState([speechFont](FacialState &s) { s.speechFont = speechFont; });
 }
 
 void Avatar::setBatteryIcon(bool batteryIcon) {
-  if (!batteryIcon) {
-    batteryIconStatus = BatteryIconStatus::invisible;
-  } else {
-    batteryIconStatus = BatteryIconStatus::unknown;
-  }
+  modifyState([batteryIcon](FacialState &s) {
+    if (!batteryIcon) {
+      s.batteryIconStatus = BatteryIconStatus::invisible;
+    } else {
+      s.batteryIconStatus = BatteryIconStatus::unknown;
+    }
+  });
 }
 
 void Avatar::setBatteryStatus(bool isCharging, int32_t batteryLevel) {
-  if (this->batteryIconStatus != BatteryIconStatus::invisible) {
-    if (isCharging) {
-      this->batteryIconStatus = BatteryIconStatus::charging;
-    } else {
-      this->batteryIconStatus = BatteryIconStatus::discharging;
+  modifyState([isCharging, batteryLevel](FacialState &s) {
+    if (s.batteryIconStatus != BatteryIconStatus::invisible) {
+      if (isCharging) {
+        s.batteryIconStatus = BatteryIconStatus::charging;
+      } else {
+        s.batteryIconStatus = BatteryIconStatus::discharging;
+      }
+      s.batteryLevel = batteryLevel;
     }
-    this->batteryLevel = batteryLevel;
-  }
+  });
 }
 
 void Avatar::setColorDepth(int color_depth) {
   if (color_depth < 1) {
     color_depth = 1;
   }
-  this->colorDepth = color_depth;
+  bool changed = false;
+  modifyState([color_depth, &changed](FacialState &s) {
+    changed = s.colorDepth != color_depth;
+    s.colorDepth = color_depth;
+  });
+  if (changed) {
+    restartWarmUp();
+  }
 }
 
 }  // namespace m5avatar
@@ -6,23 +6,21 @@
 #define AVATAR_H_
 #include <M5GFX.h>
 
+#include <memory>
+
+#include "BehaviorScheduler.hpp"
+#include "Clock.hpp"
 #include "ColorPalette.h"
 #include "Face.h"
-
-#ifdef SDL_h_
-typedef SDL_ThreadFunction TaskFunction_t;
-typedef int BaseType_t;
-typedef unsigned int UBaseType_t;
-typedef SDL_Thread *TaskHandle_t;
-typedef int TaskResult_t;
-#define APP_CPU_NUM (1)
-#else
-typedef void TaskResult_t;
-#endif
-
-#ifndef APP_CPU_NUM
-#define APP_CPU_NUM PRO_CPU_NUM
-#endif
+#include "FacialState.hpp"
+#include "FrameScheduler.hpp"
+#include "FrameStats.hpp"
+#include "Random.hpp"
+#include "RenderScheduler.hpp"
+#include "SeqLock.hpp"
+#include "TaskManager.hpp"
+#include "TaskSignal.hpp"
+#include "TraceRecorder.hpp"
 
 #ifndef ARDUINO
 #include <string>
@@ -32,34 +30,82 @@ typedef std::string String;
 namespace m5avatar {
 class Avatar {
  private:
-  Face *face;
+  // written by setFace() from any task. draw() loads it once per frame
+  SeqLock<Face *> face;
   bool _isDrawing;
-  Expression expression;
-  float breath;
-
-  // eyes variables
-  float rightEyeOpenRatio_;
-  float rightGazeV_;
-  float rightGazeH_;
-
-  float leftEyeOpenRatio_;
-  float leftGazeV_;
-  float leftGazeH_;
-
-  bool isAutoBlink_;
-
-  float mouthOpenRatio;
-
-  float rotation;
-  float scale;
-  ColorPalette palette;
-  String speechText;
-  int colorDepth;
-  BatteryIconStatus batteryIconStatus;
-  int32_t batteryLevel;
-  const lgfx::IFont *speechFont;
+  // parameters drawn in a frame. setters publish them without blocking and
+  // draw() reads a consistent snapshot
+  SeqLock<FacialState> state;
+
+  // immutable text replaced by setSpeechText(). frames share it without
+  // copying
+  std::shared_ptr<const String> speechText;
   bool runing_in_x_task_;
 
+  // frames of the warm-up so far. used only by draw()
+  uint32_t frameCount;
+  // written by restartWarmUp() from any task. draw() restarts the warm-up
+  // when its version is not warmUpVersion
+  SeqLock<bool> warmUpRequest;
+  uint32_t warmUpVersion;
+  // allow allocations in the next frames, e.g. after a layout change
+  void restartWarmUp();
+  // allocations in the last frame. see getFrameAllocationCount()
+  uint32_t frameAllocations;
+  uint32_t frameAllocatedBytes;
+  // frames which allocated after the warm-up
+  uint32_t allocationViolations;
+
+#ifdef M5AVATAR_FRAME_STATS
+  // time of each stage of draw(). see getFrameStats()
+  FrameStats frameStats;
+  uint32_t frameStatsInterval;
+  uint32_t lastFrameStatsDump;
+  void dumpFrameStats();
+#endif
+
+  // paces draw() in the draw task
+  FrameScheduler scheduler;
+  // the draw task sleeps while the state is the same as the last frame
+  bool skipUnchangedFrames;
+  uint32_t drawnVersion;
+
+  // setter is the name of the calling setter in traces
+  template <typename F>
+  void modifyState(F f, const char *setter = M5AVATAR_TRACE_CALLER) {
+    M5AVATAR_TRACE_SCOPE("setter", setter);
+    state.modify(f);
+    wakeDrawTask();
+  }
+  void wakeDrawTask();
+  void waitForChange();
+  // wait until the loops of the last start() exit
+  bool waitForLoops(uint32_t timeout_ms);
+
+  // blink, saccade, breath and user behaviors
+  BehaviorScheduler behaviors;
+  // time of behaviors. see setClock()
+  Clock *clock;
+  // random numbers of behaviors. see getRandom()
+  Random random;
+  TaskSignal drawSignal;
+  TaskSignal facialSignal;
+
+  // drawLoop, facialLoop and tasks added by addTask()
+  TaskManager tasks;
+
+  // render/transfer pipeline. see setPipelined()
+  bool pipelined;
+  BaseType_t renderCore;
+  UBaseType_t renderPriority;
+  BaseType_t transferCore;
+  UBaseType_t transferPriority;
+
+  // display of this avatar and the task drawing it. see setOutput() and
+  // setRenderScheduler()
+  LovyanGFX *output;
+  RenderScheduler *renderer;
+
  public:
   Avatar();
   explicit Avatar(Face *face);
@@ -69,7 +115,63 @@ class Avatar {
   Face *getFace() const;
   ColorPalette getColorPalette() const;
   void setColorPalette(ColorPalette cp);
+
+  /**
+   * @brief switch the face
+   *
+   * The avatar deletes the face it holds when destroyed. The previous face
+   * is not deleted, so that faces can be switched back and forth; delete it
+   * when it is no longer used.
+   *
+   * Can be called while the avatar is running. A frame in progress is
+   * finished with the previous face and the next frame draws the new one,
+   * so keep the previous face alive until then.
+   */
   void setFace(Face *face);
+
+  /**
+   * @brief set the display the avatar is drawn to
+   *
+   * M5.Display by default. Avatars on the same display are placed with
+   * setPosition() and drawn by one RenderScheduler.
+   *
+   * @param output display or sprite
+   */
+  void setOutput(LovyanGFX *output);
+  LovyanGFX *getOutput() const;
+
+  /**
+   * @brief draw the avatar from a task shared with other avatars
+   *
+   * start() adds the avatar to the scheduler instead of creating drawLoop.
+   * Call this before start(). The scheduler is started by the caller.
+   *
+   * @param renderer shared draw task, or nullptr for drawLoop
+   */
+  void setRenderScheduler(RenderScheduler *renderer);
+  RenderScheduler *getRenderScheduler() const;
+
+  /**
+   * @brief set the time source of behaviors such as blink and breath
+   *
+   * Behaviors keep their remaining time. A ManualClock or an
+   * AcceleratedClock replays behaviors faster than real time. Frames are
+   * still paced in real time. The clock is not owned by the avatar.
+   *
+   * @param clock nullptr to use the real clock
+   */
+  void setClock(Clock *clock);
+  Clock *getClock() const;
+
+  /**
+   * @brief random numbers of behaviors such as blink and saccade
+   *
+   * Each avatar is seeded with the order it was constructed in. Set the seed
+   * and a ManualClock to repeat the same behaviors. Use it from behaviors,
+   * which run in the facial task.
+   */
+  Random *getRandom();
+  void setRandomSeed(uint32_t seed);
   void init(int colorDepth = 1);
   // expression i/o
   Expression getExpression();
@@ -104,6 +206,11 @@ class Avatar {
   float getLeftEyeOpenRatio();
   void setIsAutoBlink(bool b);
   bool getIsAutoBlink();
+  void setIsAutoBreath(bool b);
+  bool getIsAutoBreath();
+  // look around at random. the gaze is kept when disabled
+  void setIsAutoSaccade(bool b);
+  bool getIsAutoSaccade();
 
   void setMouthOpenRatio(float ratio);
   void setSpeechText(const char *speechText);
@@ -113,17 +220,194 @@ class Avatar {
   void setScale(float scale);
   void setColorDepth(int color_depth = 1);
   void draw(void);
+
+  /**
+   * @brief heap allocations counted in the last draw()
+   *
+   * Allocations are counted only when the library is built with
+   * M5AVATAR_COUNT_ALLOCATIONS. In that build, a frame which allocates after
+   * the warm-up frames is logged as a warning and counted (see
+   * getAllocationViolationCount()). The warm-up starts again after the
+   * warning and after setFace(), setOutput(), setPosition(),
+   * setScale(), setColorDepth() and setSpeechText(), which let the next
+   * frames allocate buffers. Sprites allocated by LGFX are not counted; call
+   * Face::setRetainSprite(true) to keep the frame sprite between frames.
+   */
+  uint32_t getFrameAllocationCount();
+
+  // bytes allocated by operator new in the last draw(). see
+  // getFrameAllocationCount() and getHeapInfo()
+  uint32_t getFrameAllocatedBytes();
+
+  /**
+   * @brief frames which allocated after the warm-up since the avatar was
+   * created
+   *
+   * Tests fail when this is not 0. Always 0 without
+   * M5AVATAR_COUNT_ALLOCATIONS.
+   */
+  uint32_t getAllocationViolationCount();
+
+  /**
+   * @brief histograms of the time spent in each stage of the frames
+   *
+   * Stages are timed only when the library is built with
+   * M5AVATAR_FRAME_STATS. Otherwise the timers and the histograms are
+   * compiled out.
+   *
+   * @return FrameStats* nullptr without M5AVATAR_FRAME_STATS
+   */
+  FrameStats *getFrameStats();
+
+  /**
+   * @brief print the frame stats periodically
+   *
+   * The stats are printed by the draw task and reset, so that each dump
+   * covers one interval. Ignored unless built with M5AVATAR_FRAME_STATS.
+   *
+   * @param interval_ms interval of dumps. 0 disables dumps
+   */
+  void setFrameStatsDump(uint32_t interval_ms);
+
+  /**
+   * @brief set the frame rate of the draw task
+   *
+   * Frames are drawn at absolute deadlines. Frames which cannot be drawn in
+   * time are skipped. Without a target frame rate (0, the default), the draw
+   * task waits 10 ms after each frame.
+   *
+   * @param fps frames per second
+   * @param adaptive lower the frame rate down to min_fps while deadlines are
+   * missed repeatedly
+   * @param min_fps the lowest frame rate in the adaptive mode
+   */
+  void setTargetFps(uint32_t fps, bool adaptive = false,
+                    uint32_t min_fps = 10);
+  uint32_t getTargetFps();
+  // counters of frames, missed deadlines and skipped frames
+  const FrameScheduler *getFrameScheduler() const;
+
+  /**
+   * @brief skip frames while nothing changed
+   *
+   * The draw task sleeps until a setter, setFace(), setPosition() or
+   * requestRedraw() is called. Enabled by default. A static avatar (auto
+   * blink, auto breath and auto saccade off, no speech) then uses almost no
+   * CPU.
+   *
+   * @param b false to draw every frame
+   */
+  void setSkipUnchangedFrames(bool b);
+  bool getSkipUnchangedFrames();
+
+  /**
+   * @brief draw the next frame even if no parameter changed
+   *
+   * Call this after changing the face or its parts directly.
+   */
+  void requestRedraw();
+  // the state changed since the last frame, or unchanged frames are drawn
+  bool needsRedraw();
   bool isDrawing();
+
+  /**
+   * @brief start drawLoop and facialLoop
+   *
+   * Loops stopped by stop() are waited for, so stop() and start() can be
+   * called back to back. isDrawing() stays false when a task cannot be
+   * created.
+   */
   void start(int colorDepth = 1);
+
+  /**
+   * @brief render and transfer frames in two tasks
+   *
+   * drawLoop rasterizes the next frame while transferLoop resamples and
+   * pushes the last one, each on its own core. Frames are handed over
+   * through the frame buffers of the face (see Face::setPipelined()).
+   * Call this before start(). Cores are ignored on SDL.
+   *
+   * @param enabled true to run the pipeline
+   * @param render_core core of drawLoop
+   * @param render_priority priority of drawLoop
+   * @param transfer_core core of transferLoop
+   * @param transfer_priority priority of transferLoop
+   */
+  void setPipelined(bool enabled, BaseType_t render_core = APP_CPU_NUM,
+                    UBaseType_t render_priority = 1,
+                    BaseType_t transfer_core = PRO_CPU_NUM,
+                    UBaseType_t transfer_priority = 1);
+  bool isPipelined();
+
+  /**
+   * @brief stop the tasks of the avatar
+   *
+   * Waits until the tasks exit, unless called from one of them.
+   */
   void stop();
-  void addTask(TaskFunction_t f, const char *name,
+
+  /**
+   * @brief run a task with a DriveContext of this avatar
+   *
+   * @param f function of the task
+   * @param name unique name of the task
+   * @param stack_size stack size of the task
+   * @param priority priority of the task
+   * @param task_handle receives the handle of the task if not NULL
+   * @param core_id core to run the task on
+   * @return false if the name is taken or the task cannot be created
+   */
+  bool addTask(TaskFunction_t f, const char *name,
                const uint32_t stack_size = 2048, UBaseType_t priority = 4,
                TaskHandle_t *const task_handle = NULL,
                const BaseType_t core_id = APP_CPU_NUM);
+
+  /**
+   * @brief delete a task added by addTask()
+   *
+   * drawLoop and facialLoop end with stop() instead.
+   */
+  bool removeTask(const char *name);
+
+  // name, stack high-water mark and CPU usage of each task
+  std::vector<TaskInfo> getTasks();
+  // called by a task returning by itself. see TaskManager::exit()
+  void exitTask(const char *name);
   void suspend();
   void resume();
   void update();
+  // frame pacing of the draw task. see setTargetFps()
+  void beginFrames();
+  // called by the draw task before it exits
+  void endFrames();
+  // push a frame rendered by drawLoop. see setPipelined()
+  void presentFrame();
+  void waitNextFrame();
   void updateFacialParameters();
+
+  /**
+   * @brief add a behavior called in the facial task
+   *
+   * The behavior of the same name is replaced. Built-in behaviors are
+   * "saccade", "blink" and "breath".
+   *
+   * @param name unique name. kept as a pointer, e.g. a string literal
+   * @param function returns the period until the next call in milliseconds,
+   * or BehaviorScheduler::kStop (see BehaviorFunction)
+   * @param arg passed to the function
+   * @param delay_ms milliseconds until the first call
+   * @return false if too many behaviors are added
+   */
+  bool addBehavior(const char *name, BehaviorFunction function,
+                   void *arg = nullptr, uint32_t delay_ms = 0);
+  bool removeBehavior(const char *name);
+  // call due behaviors. returns milliseconds until the next one
+  uint32_t runBehaviors();
+  // sleep of the facial task. see facialLoop
+  void beginBehaviors();
+  void waitForBehaviors(uint32_t ms);
+  // called by the facial task before it exits
+  void endBehaviors();
   void setBatteryIcon(bool iconStatus);
   void setBatteryStatus(bool isCharging, int32_t batteryLevel);
 };
@@ -22,29 +22,24 @@ const int cy = 220;
 
 namespace m5avatar {
 class Balloon final : public Drawable {
- public:
-  // constructor
-  Balloon() = default;
-  ~Balloon() = default;
-  Balloon(const Balloon &other) = default;
-  Balloon &operator=(const Balloon &other) = default;
-  void draw(M5Canvas *spi, BoundingRect rect,
-            DrawContext *drawContext) override {
-    String text = drawContext->getspeechText();
+ private:
+  template <typename T>
+  void render(T *spi, BoundingRect rect, DrawContext *drawContext) {
+    const String &text = drawContext->getspeechText();
     const lgfx::IFont *font = drawContext->getSpeechFont();
     if (text.length() == 0) {
       return;
     }
-    ColorPalette* cp = drawContext->getColorPalette();
+    const ColorPalette* cp = drawContext->getResolvedPalette();
     uint16_t primaryColor = cp->get(COLOR_BALLOON_FOREGROUND);
     uint16_t backgroundColor = cp->get(COLOR_BALLOON_BACKGROUND);
-    M5.Lcd.setTextSize(TEXT_SIZE);
-    M5.Lcd.setTextDatum(MC_DATUM);
     spi->setTextSize(TEXT_SIZE);
     spi->setTextColor(primaryColor, backgroundColor);
     spi->setTextDatum(MC_DATUM);
-    M5.Lcd.setFont(font);
-    int textWidth = M5.Lcd.textWidth(text.c_str());
+    // measured on the target instead of the display, which may be drawn by
+    // another task
+    spi->setFont(font);
+    int textWidth = spi->textWidth(text.c_str());
     int textHeight = TEXT_HEIGHT * TEXT_SIZE;
     spi->fillEllipse(cx - 20, cy,textWidth + 2, textHeight * 2 + 2,
                      primaryColor);
@@ -56,6 +51,22 @@ class Balloon final : public Drawable {
                       backgroundColor);
     spi->drawString(text.c_str(), cx - textWidth / 6 - 15, cy, font);  // Continue printing from new x position
   }
+
+ public:
+  // constructor
+  Balloon() = default;
+  ~Balloon() = default;
+  Balloon(const Balloon &other) = default;
+  Balloon &operator=(const Balloon &other) = default;
+  void draw(M5Canvas *spi, BoundingRect rect,
+            DrawContext *drawContext) override {
+    render(spi, rect, drawContext);
+  }
+  bool record(DisplayList *list, BoundingRect rect,
+              DrawContext *drawContext) override {
+    render(list, rect, drawContext);
+    return true;
+  }
 };
 
 }  // namespace m5avatar
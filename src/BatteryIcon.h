@@ -13,7 +13,8 @@ namespace m5avatar {
 
 class BatteryIcon final : public Drawable {
  private:
-  void drawBatteryIcon(M5Canvas *spi, uint32_t x, uint32_t y, uint16_t fgcolor, uint16_t bgcolor, float offset, BatteryIconStatus batteryIconStatus, int32_t batteryLevel) {
+  template <typename T>
+  void drawBatteryIcon(T *spi, uint32_t x, uint32_t y, uint16_t fgcolor, uint16_t bgcolor, float offset, BatteryIconStatus batteryIconStatus, int32_t batteryLevel) {
     spi->drawRect(x, y + 5, 5, 5, fgcolor);
     spi->drawRect(x + 5, y, 30, 15, fgcolor);
     int battery_width = 30 * (float)(batteryLevel / 100.0f);
@@ -28,6 +29,17 @@ class BatteryIcon final : public Drawable {
     }
  }
 
+  template <typename T>
+  void render(T *spi, BoundingRect rect, DrawContext *ctx) {
+    if (ctx->getBatteryIconStatus() != BatteryIconStatus::invisible) {
+      uint16_t primaryColor = ctx->getResolvedPalette()->get(COLOR_PRIMARY);
+      uint16_t bgColor = ctx->getResolvedPalette()->get(COLOR_BACKGROUND);
+      float offset = ctx->getBreath();
+      int32_t batteryLevel = ctx->getBatteryLevel();
+      drawBatteryIcon(spi, 285, 5, primaryColor, bgColor, -offset, ctx->getBatteryIconStatus(), batteryLevel);
+    }
+  }
+
  public:
   // constructor
   BatteryIcon() = default;
@@ -35,15 +47,13 @@ class BatteryIcon final : public Drawable {
   BatteryIcon(const BatteryIcon &other) = default;
   BatteryIcon &operator=(const BatteryIcon &other) = default;
   void draw(M5Canvas *spi, BoundingRect rect, DrawContext *ctx) override {
-    if (ctx->getBatteryIconStatus() != BatteryIconStatus::invisible) {
-      uint16_t primaryColor = ctx->getColorDepth() == 1 ? 1 : ctx->getColorPalette()->get(COLOR_PRIMARY);
-      uint16_t bgColor = ctx->getColorDepth() == 1 ? ERACER_COLOR : ctx->getColorPalette()->get(COLOR_BACKGROUND);
-      float offset = ctx->getBreath();
-      int32_t batteryLevel = ctx->getBatteryLevel();
-      drawBatteryIcon(spi, 285, 5, primaryColor, bgColor, -offset, ctx->getBatteryIconStatus(), batteryLevel);
-    }
-  };
-
+    render(spi, rect, ctx);
+  }
+  bool record(DisplayList *list, BoundingRect rect,
+              DrawContext *ctx) override {
+    render(list, rect, ctx);
+    return true;
+  }
 };
 
 }  // namespace m5avatar
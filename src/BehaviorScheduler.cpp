@@ -0,0 +1,164 @@
+/**
+ * @file BehaviorScheduler.cpp
+ * @brief timers of facial behaviors such as blink and saccade
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "BehaviorScheduler.hpp"
+
+#include <cstring>
+
+#include "TraceRecorder.hpp"
+
+namespace m5avatar {
+
+constexpr size_t BehaviorScheduler::kMaxBehaviors;
+constexpr uint32_t BehaviorScheduler::kStop;
+constexpr uint32_t BehaviorScheduler::kNoneDue;
+
+BehaviorScheduler::BehaviorScheduler() : slots{}, lock{} {}
+
+BehaviorScheduler::BehaviorScheduler(const BehaviorScheduler &other)
+    : BehaviorScheduler() {
+  *this = other;
+}
+
+BehaviorScheduler &BehaviorScheduler::operator=(
+    const BehaviorScheduler &other) {
+  if (this != &other) {
+    Slot copy[kMaxBehaviors];
+    other.lock.lock();
+    memcpy(copy, other.slots, sizeof(copy));
+    other.lock.unlock();
+    lock.lock();
+    memcpy(slots, copy, sizeof(slots));
+    lock.unlock();
+  }
+  return *this;
+}
+
+int BehaviorScheduler::find(const char *name) const {
+  for (size_t i = 0; i < kMaxBehaviors; i++) {
+    if (slots[i].used && strcmp(slots[i].name, name) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+bool BehaviorScheduler::add(const char *name, BehaviorFunction function,
+                            void *arg, uint32_t now, uint32_t delay_ms) {
+  lock.lock();
+  int index = find(name);
+  if (index < 0) {
+    for (size_t i = 0; i < kMaxBehaviors; i++) {
+      if (!slots[i].used) {
+        index = i;
+        break;
+      }
+    }
+  }
+  if (index < 0) {
+    lock.unlock();
+    M5_LOGE("too many behaviors to add %s", name);
+    return false;
+  }
+  Slot &slot = slots[index];
+  slot.name = name;
+  slot.function = function;
+  slot.arg = arg;
+  slot.due = now + delay_ms;
+  slot.generation++;
+  slot.used = true;
+  lock.unlock();
+  return true;
+}
+
+bool BehaviorScheduler::remove(const char *name) {
+  lock.lock();
+  int index = find(name);
+  if (index >= 0) {
+    slots[index].used = false;
+    slots[index].generation++;
+  }
+  lock.unlock();
+  return index >= 0;
+}
+
+bool BehaviorScheduler::contains(const char *name) {
+  lock.lock();
+  bool found = find(name) >= 0;
+  lock.unlock();
+  return found;
+}
+
+void BehaviorScheduler::rebase(uint32_t from, uint32_t to) {
+  lock.lock();
+  for (size_t i = 0; i < kMaxBehaviors; i++) {
+    slots[i].due += to - from;
+  }
+  lock.unlock();
+}
+
+uint32_t BehaviorScheduler::untilNext(uint32_t now) {
+  uint32_t next = kNoneDue;
+  lock.lock();
+  for (size_t i = 0; i < kMaxBehaviors; i++) {
+    if (!slots[i].used) {
+      continue;
+    }
+    int32_t remaining = static_cast<int32_t>(slots[i].due - now);
+    uint32_t wait = remaining > 0 ? remaining : 0;
+    if (wait < next) {
+      next = wait;
+    }
+  }
+  lock.unlock();
+  return next;
+}
+
+uint32_t BehaviorScheduler::run(uint32_t now) {
+  for (size_t i = 0; i < kMaxBehaviors; i++) {
+    Slot &slot = slots[i];
+    lock.lock();
+    if (!slot.used || static_cast<int32_t>(now - slot.due) < 0) {
+      lock.unlock();
+      continue;
+    }
+    BehaviorFunction function = slot.function;
+    void *arg = slot.arg;
+    // copied under the lock. used only by traces
+    const char *name = slot.name;
+    (void)name;
+    uint16_t generation = slot.generation;
+    lock.unlock();
+
+    // called without the lock. the behavior may call setters or add()
+    uint32_t delay_ms;
+    {
+      M5AVATAR_TRACE_SCOPE("behavior", name);
+      delay_ms = function(arg);
+    }
+
+    lock.lock();
+    if (slot.used && slot.generation == generation) {
+      if (delay_ms == kStop) {
+        slot.used = false;
+        slot.generation++;
+      } else if (now - slot.due > delay_ms) {
+        // more than a period late. skip the missed calls
+        slot.due = now + delay_ms;
+      } else {
+        // from the due time, so that the lateness of a call does not add up
+        slot.due += delay_ms;
+      }
+    }
+    lock.unlock();
+  }
+  return untilNext(now);
+}
+
+}  // namespace m5avatar
@@ -0,0 +1,101 @@
+/**
+ * @file BehaviorScheduler.hpp
+ * @brief timers of facial behaviors such as blink and saccade
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef M5AVATAR_BEHAVIOR_SCHEDULER_HPP_
+#define M5AVATAR_BEHAVIOR_SCHEDULER_HPP_
+
+#include <M5Unified.h>
+
+#include "SpinLock.hpp"
+
+namespace m5avatar {
+
+/**
+ * @brief function of a behavior
+ *
+ * @param arg argument given to BehaviorScheduler::add()
+ * @return milliseconds from the due time of this call to the next one, or
+ * BehaviorScheduler::kStop to remove the behavior. a behavior more than one
+ * period late is rescheduled from the current time
+ */
+typedef uint32_t (*BehaviorFunction)(void *arg);
+
+/**
+ * @brief fixed table of behaviors with their next fire time
+ *
+ * run() calls the due behaviors and returns the time until the earliest next
+ * one, so that the caller sleeps exactly until then. Behaviors are added and
+ * removed from any task; they are called in the task calling run().
+ */
+class BehaviorScheduler {
+ public:
+  static constexpr size_t kMaxBehaviors = 8;
+  // returned by a behavior to remove itself
+  static constexpr uint32_t kStop = UINT32_MAX;
+  // returned by run() when no behavior is scheduled
+  static constexpr uint32_t kNoneDue = UINT32_MAX;
+
+ private:
+  struct Slot {
+    // NOTE: not copied. keep the name alive while the behavior is added
+    const char *name;
+    BehaviorFunction function;
+    void *arg;
+    uint32_t due;
+    // changed by add() and remove() to detect a slot reused during a call
+    uint16_t generation;
+    bool used;
+  };
+  Slot slots[kMaxBehaviors];
+  mutable SpinLock lock;
+
+  int find(const char *name) const;
+  uint32_t untilNext(uint32_t now);
+
+ public:
+  BehaviorScheduler();
+  ~BehaviorScheduler() = default;
+  BehaviorScheduler(const BehaviorScheduler &other);
+  BehaviorScheduler &operator=(const BehaviorScheduler &other);
+
+  /**
+   * @brief add a behavior, or reschedule the behavior of the same name
+   *
+   * @param name unique name
+   * @param function called when due
+   * @param arg passed to the function
+   * @param now current time in milliseconds
+   * @param delay_ms milliseconds until the first call
+   * @return false if the table is full
+   */
+  bool add(const char *name, BehaviorFunction function, void *arg,
+           uint32_t now, uint32_t delay_ms = 0);
+  bool remove(const char *name);
+  bool contains(const char *name);
+
+  /**
+   * @brief keep the remaining time of behaviors on another clock
+   *
+   * @param from current time of the old clock
+   * @param to current time of the new clock
+   */
+  void rebase(uint32_t from, uint32_t to);
+
+  /**
+   * @brief call behaviors due at the time
+   *
+   * @param now current time in milliseconds
+   * @return milliseconds until the next behavior is due, or kNoneDue
+   */
+  uint32_t run(uint32_t now);
+};
+
+}  // namespace m5avatar
+
+#endif  // M5AVATAR_BEHAVIOR_SCHEDULER_HPP_
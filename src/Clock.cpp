@@ -0,0 +1,49 @@
+/**
+ * @file Clock.cpp
+ * @brief time source of facial behaviors and animations
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "Clock.hpp"
+
+namespace m5avatar {
+
+uint32_t RealClock::now() { return lgfx::millis(); }
+
+RealClock *RealClock::getInstance() {
+  static RealClock instance;
+  return &instance;
+}
+
+constexpr uint32_t ManualClock::kPollInterval;
+
+ManualClock::ManualClock(uint32_t start_ms) : time{start_ms} {}
+
+uint32_t ManualClock::now() { return time.load(); }
+
+uint32_t ManualClock::toRealTime(uint32_t ms) {
+  return ms < kPollInterval ? ms : kPollInterval;
+}
+
+void ManualClock::advance(uint32_t ms) { time.fetch_add(ms); }
+
+void ManualClock::set(uint32_t ms) { time.store(ms); }
+
+AcceleratedClock::AcceleratedClock(uint32_t factor)
+    : factor{factor == 0 ? 1 : factor}, origin{lgfx::millis()} {}
+
+uint32_t AcceleratedClock::now() {
+  // wraps around factor times as often as lgfx::millis(), which the
+  // behaviors handle
+  return (lgfx::millis() - origin) * factor;
+}
+
+uint32_t AcceleratedClock::toRealTime(uint32_t ms) {
+  // round up, so that a task does not wake before the behavior is due
+  return ms / factor + (ms % factor != 0 ? 1 : 0);
+}
+
+}  // namespace m5avatar
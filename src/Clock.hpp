@@ -0,0 +1,98 @@
+/**
+ * @file Clock.hpp
+ * @brief time source of facial behaviors and animations
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef M5AVATAR_CLOCK_HPP_
+#define M5AVATAR_CLOCK_HPP_
+
+#include <M5Unified.h>
+
+#include <atomic>
+
+namespace m5avatar {
+
+/**
+ * @brief time source of an avatar
+ *
+ * Behaviors such as blink, saccade and breath read the time from the clock
+ * of the avatar, so that they can be replayed faster than real time or
+ * stepped by tests. Frame pacing and frame statistics stay on real time.
+ */
+class Clock {
+ public:
+  virtual ~Clock() = default;
+
+  // milliseconds since an arbitrary origin. it wraps around
+  virtual uint32_t now() = 0;
+
+  /**
+   * @brief real time a task sleeps while the clock advances
+   *
+   * @param ms milliseconds of the clock
+   * @return uint32_t real milliseconds
+   */
+  virtual uint32_t toRealTime(uint32_t ms) { return ms; }
+};
+
+/**
+ * @brief lgfx::millis(). the default clock of avatars
+ */
+class RealClock : public Clock {
+ public:
+  uint32_t now() override;
+
+  // shared by avatars without their own clock
+  static RealClock *getInstance();
+};
+
+/**
+ * @brief clock advanced only by advance() and set()
+ *
+ * Tests usually drive an avatar which is not started: advance the clock and
+ * call Avatar::runBehaviors() and Avatar::draw(). The facial task of a
+ * started avatar polls the clock every kPollInterval.
+ */
+class ManualClock : public Clock {
+ private:
+  std::atomic<uint32_t> time;
+
+ public:
+  static constexpr uint32_t kPollInterval = 10;  // [msec]
+
+  explicit ManualClock(uint32_t start_ms = 0);
+
+  uint32_t now() override;
+  uint32_t toRealTime(uint32_t ms) override;
+  void advance(uint32_t ms);
+  void set(uint32_t ms);
+};
+
+/**
+ * @brief clock running faster than real time
+ *
+ * A factor of 60 replays an hour of behaviors in a minute.
+ */
+class AcceleratedClock : public Clock {
+ private:
+  uint32_t factor;
+  uint32_t origin;
+
+ public:
+  /**
+   * @param factor times faster than real time. 0 is treated as 1
+   */
+  explicit AcceleratedClock(uint32_t factor);
+
+  uint32_t now() override;
+  uint32_t toRealTime(uint32_t ms) override;
+  uint32_t getFactor() const { return factor; }
+};
+
+}  // namespace m5avatar
+
+#endif  // M5AVATAR_CLOCK_HPP_
@@ -7,39 +7,38 @@
 namespace m5avatar {
 
 using DLoc = DrawingLocation;
-ColorPalette::ColorPalette()
-    : palette_{{DLoc::kIrisBackground, TFT_WHITE},
-               {DLoc::kMouthBackground, TFT_WHITE},
-               {DLoc::kSkin, TFT_BLACK},
-               {DLoc::kBalloonForeground, TFT_BLACK},
-               {DLoc::kBalloonBackground, TFT_WHITE}} {}
-
-uint16_t ColorPalette::get(DrawingLocation key) const {
-  auto itr = palette_.find(key);
-  if (itr != palette_.end()) {
-    return itr->second;
-  } else {
-    // NOTE: if no value it returns BLACK(0x00) as the default value of the
-    // type(int)
-    // M5_LOGI("no color with the key %d", key);
-    return TFT_BLACK;
-  }
+
+constexpr size_t ColorPalette::kNumLocations;
+
+ColorPalette::ColorPalette() : colors_{}, present_{0} {
+  set(DLoc::kIrisBackground, TFT_WHITE);
+  set(DLoc::kMouthBackground, TFT_WHITE);
+  set(DLoc::kSkin, TFT_BLACK);
+  set(DLoc::kBalloonForeground, TFT_BLACK);
+  set(DLoc::kBalloonBackground, TFT_WHITE);
 }
 
 void ColorPalette::set(DrawingLocation key, uint16_t value) {
-  auto itr = palette_.find(key);
-  if (itr != palette_.end()) {
-    // M5_LOGI("Overwriting");
-    itr->second = value;
+  size_t index = static_cast<size_t>(key);
+  if (index >= kNumLocations) {
+    M5_LOGE("invalid palette key %d", static_cast<int>(index));
     return;
   }
-
-  // insert new color
-  palette_.insert(std::make_pair(key, value));
+  colors_[index] = value;
+  present_ |= 1u << index;
 }
 
-bool ColorPalette::contains(DrawingLocation key) {
-  auto itr = palette_.find(key);
-  return itr != palette_.end();
+void ColorPalette::clear(void) { present_ = 0; }
+
+ColorPalette ColorPalette::resolve(int colorDepth) const {
+  ColorPalette resolved(*this);
+  if (colorDepth != 1) {
+    return resolved;
+  }
+  uint16_t background = get(DLoc::kSkin);
+  for (size_t i = 0; i < kNumLocations; i++) {
+    resolved.colors_[i] = colors_[i] == background ? 0 : 1;
+  }
+  return resolved;
 }
 }  // namespace m5avatar
@@ -6,7 +6,6 @@
 #define COLOR_PALETTE_H_
 #include <M5Unified.h>
 
-#include <map>
 #include <string>
 
 namespace m5avatar {
@@ -46,10 +45,20 @@ enum class DrawingLocation : unsigned char {
 
 /**
  * Color palette for drawing face
+ *
+ * Colors are stored in an array indexed by DrawingLocation, so get() and
+ * contains() are constant time.
  */
 class ColorPalette {
+ public:
+  // number of DrawingLocation keys
+  static constexpr size_t kNumLocations =
+      static_cast<size_t>(DrawingLocation::kBalloonBackground) + 1;
+
  private:
-  std::map<DrawingLocation, uint16_t> palette_;
+  uint16_t colors_[kNumLocations];
+  // bit i is set when location i has a color
+  uint32_t present_;
 
  public:
   // TODO(meganetaaan): constructor with color settings
@@ -58,10 +67,30 @@ class ColorPalette {
   ColorPalette(const ColorPalette &other) = default;
   ColorPalette &operator=(const ColorPalette &other) = default;
 
-  uint16_t get(DrawingLocation key) const;
+  uint16_t get(DrawingLocation key) const {
+    // NOTE: if no value it returns BLACK(0x00) as the default value
+    return contains(key) ? colors_[static_cast<size_t>(key)] : TFT_BLACK;
+  }
   void set(DrawingLocation key, uint16_t value);
-  bool contains(DrawingLocation key);
+  bool contains(DrawingLocation key) const {
+    return static_cast<size_t>(key) < kNumLocations &&
+           (present_ >> static_cast<size_t>(key) & 1u) != 0;
+  }
   void clear(void);
+
+  /**
+   * @brief colors to draw with in a color depth
+   *
+   * For 1-bit color depth, colors are palette indices of the 1-bit sprite:
+   * 0 for colors same as the background (kSkin) and 1 for the others. For
+   * other color depths, colors are RGB565 as they are and LGFX converts them
+   * into the color depth of the sprite. Locations without colors are kept
+   * without colors.
+   *
+   * @param colorDepth color depth of the sprite drawn into
+   * @return ColorPalette resolved colors
+   */
+  ColorPalette resolve(int colorDepth) const;
 };
 }  // namespace m5avatar
 
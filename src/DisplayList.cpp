@@ -0,0 +1,519 @@
+#include "DisplayList.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace m5avatar {
+
+namespace {
+
+int16_t clampCoord(int32_t v) {
+  if (v < std::numeric_limits<int16_t>::min()) {
+    return std::numeric_limits<int16_t>::min();
+  }
+  if (v > std::numeric_limits<int16_t>::max()) {
+    return std::numeric_limits<int16_t>::max();
+  }
+  return v;
+}
+
+bool isEmpty(const DisplayCommand &c) {
+  return c.right <= c.left || c.bottom <= c.top;
+}
+
+void unite(int32_t &left, int32_t &top, int32_t &right, int32_t &bottom,
+           const DisplayCommand &c) {
+  if (isEmpty(c)) {
+    return;
+  }
+  left = std::min<int32_t>(left, c.left);
+  top = std::min<int32_t>(top, c.top);
+  right = std::max<int32_t>(right, c.right);
+  bottom = std::max<int32_t>(bottom, c.bottom);
+}
+
+BoundingRect toRect(int32_t left, int32_t top, int32_t right,
+                    int32_t bottom) {
+  if (right <= left || bottom <= top) {
+    return BoundingRect(0, 0, 0, 0);
+  }
+  return BoundingRect(top, left, right - left, bottom - top);
+}
+
+template <typename T>
+void renderCommand(M5Canvas *canvas, const DisplayCommand &c, int32_t ox,
+                   int32_t oy, const char *text, T color) {
+  const int16_t *v = c.v;
+  switch (c.type) {
+    case DisplayCommandType::kFillRect:
+      canvas->fillRect(v[0] - ox, v[1] - oy, v[2], v[3], color);
+      break;
+    case DisplayCommandType::kDrawRect:
+      canvas->drawRect(v[0] - ox, v[1] - oy, v[2], v[3], color);
+      break;
+    case DisplayCommandType::kFillCircle:
+      canvas->fillCircle(v[0] - ox, v[1] - oy, v[2], color);
+      break;
+    case DisplayCommandType::kDrawCircle:
+      canvas->drawCircle(v[0] - ox, v[1] - oy, v[2], color);
+      break;
+    case DisplayCommandType::kFillEllipse:
+      canvas->fillEllipse(v[0] - ox, v[1] - oy, v[2], v[3], color);
+      break;
+    case DisplayCommandType::kFillTriangle:
+      canvas->fillTriangle(v[0] - ox, v[1] - oy, v[2] - ox, v[3] - oy,
+                           v[4] - ox, v[5] - oy, color);
+      break;
+    case DisplayCommandType::kDrawLine:
+      canvas->drawLine(v[0] - ox, v[1] - oy, v[2] - ox, v[3] - oy, color);
+      break;
+    case DisplayCommandType::kFillArc:
+      canvas->fillArc(v[0] - ox, v[1] - oy, v[2], v[3], c.f[0], c.f[1],
+                      color);
+      break;
+    case DisplayCommandType::kDrawArc:
+      canvas->drawArc(v[0] - ox, v[1] - oy, v[2], v[3], c.f[0], c.f[1],
+                      color);
+      break;
+    case DisplayCommandType::kFloodFill:
+      canvas->floodFill(v[0] - ox, v[1] - oy, color);
+      break;
+    case DisplayCommandType::kText:
+      canvas->setTextSize(c.f[0]);
+      canvas->setTextDatum(c.datum);
+      canvas->setTextColor(color, static_cast<T>(c.background));
+      canvas->drawString(text + v[2], v[0] - ox, v[1] - oy,
+                         static_cast<const lgfx::IFont *>(c.data));
+      break;
+    default:
+      break;
+  }
+}
+
+}  // namespace
+
+DisplayList::DisplayList()
+    : commands{},
+      text{},
+      overflowed{false},
+      unbounded{false},
+      clipped{false},
+      clipLeft{0},
+      clipTop{0},
+      clipRight{0},
+      clipBottom{0},
+      textSize{1.0f},
+      textDatum{0},
+      textColor{0xFFFFFFu},
+      textBackground{0},
+      textColorBytes{4},
+      font{nullptr},
+      measure{} {}
+
+void DisplayList::reserve(size_t capacity, size_t text_capacity) {
+  commands.reserve(capacity);
+  text.reserve(text_capacity);
+}
+
+M5Canvas *DisplayList::TextMeasure::get() {
+  if (canvas == nullptr) {
+    canvas = new M5Canvas();
+  }
+  return canvas;
+}
+
+void DisplayList::TextMeasure::reset() {
+  delete canvas;
+  canvas = nullptr;
+}
+
+void DisplayList::release() {
+  std::vector<DisplayCommand>().swap(commands);
+  std::vector<char>().swap(text);
+  measure.reset();
+  clear();
+}
+
+void DisplayList::clear() {
+  commands.clear();
+  text.clear();
+  overflowed = false;
+  unbounded = false;
+  clipped = false;
+  textSize = 1.0f;
+  textDatum = 0;
+  textColor = 0xFFFFFFu;
+  textBackground = 0;
+  textColorBytes = 4;
+  font = nullptr;
+}
+
+void DisplayList::swap(DisplayList &other) {
+  // NOTE: swap buffers instead of copying them so that no memory is allocated
+  commands.swap(other.commands);
+  text.swap(other.text);
+  std::swap(overflowed, other.overflowed);
+  std::swap(unbounded, other.unbounded);
+  std::swap(clipped, other.clipped);
+  std::swap(clipLeft, other.clipLeft);
+  std::swap(clipTop, other.clipTop);
+  std::swap(clipRight, other.clipRight);
+  std::swap(clipBottom, other.clipBottom);
+  std::swap(textSize, other.textSize);
+  std::swap(textDatum, other.textDatum);
+  std::swap(textColor, other.textColor);
+  std::swap(textBackground, other.textBackground);
+  std::swap(textColorBytes, other.textColorBytes);
+  std::swap(font, other.font);
+}
+
+DisplayCommand *DisplayList::add(DisplayCommandType type, uint32_t color,
+                                 uint8_t bytes, int32_t left, int32_t top,
+                                 int32_t right, int32_t bottom) {
+  // NOTE: the buffer never grows so that recording does not allocate memory
+  if (commands.size() >= commands.capacity()) {
+    overflowed = true;
+    return nullptr;
+  }
+  if (clipped && type != DisplayCommandType::kClip) {
+    left = std::max<int32_t>(left, clipLeft);
+    top = std::max<int32_t>(top, clipTop);
+    right = std::min<int32_t>(right, clipRight);
+    bottom = std::min<int32_t>(bottom, clipBottom);
+  }
+  DisplayCommand c{};
+  c.type = type;
+  c.colorBytes = bytes;
+  c.color = color;
+  c.left = clampCoord(left);
+  c.top = clampCoord(top);
+  c.right = clampCoord(right);
+  c.bottom = clampCoord(bottom);
+  commands.push_back(c);
+  return &commands.back();
+}
+
+void DisplayList::setClipRect(int32_t x, int32_t y, int32_t w, int32_t h) {
+  // NOTE: bounds of a clip command is the clip rect itself. a change of the
+  // clip affects only pixels inside of the old or the new clip rect
+  DisplayCommand *c =
+      add(DisplayCommandType::kClip, 0, 0, x, y, x + w, y + h);
+  if (c == nullptr) {
+    return;
+  }
+  c->v[0] = 1;
+  clipped = true;
+  clipLeft = c->left;
+  clipTop = c->top;
+  clipRight = c->right;
+  clipBottom = c->bottom;
+}
+
+void DisplayList::clearClipRect() {
+  if (!clipped) {
+    return;
+  }
+  DisplayCommand *c = add(DisplayCommandType::kClip, 0, 0, clipLeft, clipTop,
+                          clipRight, clipBottom);
+  if (c == nullptr) {
+    return;
+  }
+  clipped = false;
+}
+
+void DisplayList::addRect(DisplayCommandType type, int32_t x, int32_t y,
+                          int32_t w, int32_t h, uint32_t color,
+                          uint8_t bytes) {
+  if (w < 0) {
+    x += w + 1;
+    w = -w;
+  }
+  if (h < 0) {
+    y += h + 1;
+    h = -h;
+  }
+  DisplayCommand *c = add(type, color, bytes, x, y, x + w, y + h);
+  if (c == nullptr) {
+    return;
+  }
+  c->v[0] = clampCoord(x);
+  c->v[1] = clampCoord(y);
+  c->v[2] = clampCoord(w);
+  c->v[3] = clampCoord(h);
+}
+
+void DisplayList::addEllipse(DisplayCommandType type, int32_t x, int32_t y,
+                             int32_t rx, int32_t ry, uint32_t color,
+                             uint8_t bytes) {
+  int32_t ax = std::abs(rx);
+  int32_t ay = std::abs(ry);
+  DisplayCommand *c =
+      add(type, color, bytes, x - ax, y - ay, x + ax + 1, y + ay + 1);
+  if (c == nullptr) {
+    return;
+  }
+  c->v[0] = clampCoord(x);
+  c->v[1] = clampCoord(y);
+  c->v[2] = clampCoord(rx);
+  c->v[3] = clampCoord(ry);
+}
+
+void DisplayList::addTriangle(DisplayCommandType type, int32_t x0, int32_t y0,
+                              int32_t x1, int32_t y1, int32_t x2, int32_t y2,
+                              uint32_t color, uint8_t bytes) {
+  DisplayCommand *c = add(type, color, bytes, std::min({x0, x1, x2}),
+                          std::min({y0, y1, y2}), std::max({x0, x1, x2}) + 1,
+                          std::max({y0, y1, y2}) + 1);
+  if (c == nullptr) {
+    return;
+  }
+  c->v[0] = clampCoord(x0);
+  c->v[1] = clampCoord(y0);
+  c->v[2] = clampCoord(x1);
+  c->v[3] = clampCoord(y1);
+  c->v[4] = clampCoord(x2);
+  c->v[5] = clampCoord(y2);
+}
+
+void DisplayList::addArc(DisplayCommandType type, int32_t x, int32_t y,
+                         int32_t r0, int32_t r1, float angle0, float angle1,
+                         uint32_t color, uint8_t bytes) {
+  // bounds of the arc: end points and extremes on the axes within the angles
+  float radii[] = {static_cast<float>(std::abs(r0)),
+                   static_cast<float>(std::abs(r1))};
+  float r_max = std::max(radii[0], radii[1]);
+  float start = fmodf(angle0, 360.0f);
+  if (start < 0.0f) {
+    start += 360.0f;
+  }
+  float sweep = angle1 - angle0;
+  if (sweep < 0.0f) {
+    sweep = fmodf(sweep, 360.0f) + 360.0f;
+  }
+  float min_x = x;
+  float min_y = y;
+  float max_x = x;
+  float max_y = y;
+  if (sweep >= 360.0f) {
+    min_x = x - r_max;
+    min_y = y - r_max;
+    max_x = x + r_max;
+    max_y = y + r_max;
+  } else {
+    min_x = min_y = std::numeric_limits<float>::max();
+    max_x = max_y = std::numeric_limits<float>::lowest();
+    float ends[] = {start, start + sweep};
+    for (float r : radii) {
+      for (float a : ends) {
+        float rad = a * M_PI / 180.0f;
+        float px = x + r * cosf(rad);
+        float py = y + r * sinf(rad);
+        min_x = std::min(min_x, px);
+        min_y = std::min(min_y, py);
+        max_x = std::max(max_x, px);
+        max_y = std::max(max_y, py);
+      }
+    }
+    for (int axis = 0; axis < 8; ++axis) {
+      float a = axis * 90.0f;
+      if (a < start || a > start + sweep) {
+        continue;
+      }
+      switch (axis % 4) {
+        case 0:
+          max_x = std::max<float>(max_x, x + r_max);
+          break;
+        case 1:
+          max_y = std::max<float>(max_y, y + r_max);
+          break;
+        case 2:
+          min_x = std::min<float>(min_x, x - r_max);
+          break;
+        default:
+          min_y = std::min<float>(min_y, y - r_max);
+          break;
+      }
+    }
+  }
+  // margin for rounding of the rasterizer
+  DisplayCommand *c =
+      add(type, color, bytes, floorf(min_x) - 2, floorf(min_y) - 2,
+          ceilf(max_x) + 3, ceilf(max_y) + 3);
+  if (c == nullptr) {
+    return;
+  }
+  c->v[0] = clampCoord(x);
+  c->v[1] = clampCoord(y);
+  c->v[2] = clampCoord(r0);
+  c->v[3] = clampCoord(r1);
+  c->f[0] = angle0;
+  c->f[1] = angle1;
+}
+
+void DisplayList::addFloodFill(int32_t x, int32_t y, uint32_t color,
+                               uint8_t bytes) {
+  // the filled region depends on pixels drawn before. it may cover the
+  // whole canvas
+  DisplayCommand *c = add(DisplayCommandType::kFloodFill, color, bytes,
+                          std::numeric_limits<int16_t>::min(),
+                          std::numeric_limits<int16_t>::min(),
+                          std::numeric_limits<int16_t>::max(),
+                          std::numeric_limits<int16_t>::max());
+  if (c == nullptr) {
+    return;
+  }
+  unbounded = true;
+  c->v[0] = clampCoord(x);
+  c->v[1] = clampCoord(y);
+}
+
+int32_t DisplayList::textWidth(const char *string) {
+  M5Canvas *canvas = measure.get();
+  canvas->setFont(font);
+  canvas->setTextSize(textSize);
+  return canvas->textWidth(string);
+}
+
+void DisplayList::drawString(const char *string, int32_t x, int32_t y,
+                             const lgfx::IFont *f) {
+  size_t length = strlen(string);
+  if (text.size() + length + 1 > text.capacity()) {
+    overflowed = true;
+    return;
+  }
+  M5Canvas *canvas = measure.get();
+  canvas->setFont(f);
+  canvas->setTextSize(textSize);
+  int32_t w = canvas->textWidth(string);
+  int32_t h = canvas->fontHeight();
+  // NOTE: bounds cover every text datum
+  DisplayCommand *c = add(DisplayCommandType::kText, textColor,
+                          textColorBytes, x - w, y - h, x + w + 1, y + h + 1);
+  if (c == nullptr) {
+    return;
+  }
+  c->datum = textDatum;
+  c->background = textBackground;
+  c->v[0] = clampCoord(x);
+  c->v[1] = clampCoord(y);
+  c->v[2] = text.size();
+  c->v[3] = length;
+  c->f[0] = textSize;
+  c->data = f;
+  text.insert(text.end(), string, string + length + 1);
+}
+
+BoundingRect DisplayList::getBounds() const {
+  int32_t left = std::numeric_limits<int32_t>::max();
+  int32_t top = std::numeric_limits<int32_t>::max();
+  int32_t right = std::numeric_limits<int32_t>::min();
+  int32_t bottom = std::numeric_limits<int32_t>::min();
+  for (const auto &c : commands) {
+    if (c.type != DisplayCommandType::kClip) {
+      unite(left, top, right, bottom, c);
+    }
+  }
+  return toRect(left, top, right, bottom);
+}
+
+bool DisplayList::isTextEqual(const DisplayCommand &a,
+                              const DisplayList &other,
+                              const DisplayCommand &b) const {
+  return a.v[3] == b.v[3] &&
+         memcmp(text.data() + a.v[2], other.text.data() + b.v[2], a.v[3]) == 0;
+}
+
+BoundingRect DisplayList::diff(const DisplayList &other) const {
+  int32_t left = std::numeric_limits<int32_t>::max();
+  int32_t top = std::numeric_limits<int32_t>::max();
+  int32_t right = std::numeric_limits<int32_t>::min();
+  int32_t bottom = std::numeric_limits<int32_t>::min();
+  size_t n = std::max(commands.size(), other.commands.size());
+  for (size_t i = 0; i < n; ++i) {
+    if (i >= commands.size()) {
+      unite(left, top, right, bottom, other.commands[i]);
+      continue;
+    }
+    if (i >= other.commands.size()) {
+      unite(left, top, right, bottom, commands[i]);
+      continue;
+    }
+    const DisplayCommand &a = commands[i];
+    const DisplayCommand &b = other.commands[i];
+    bool same = a.type == b.type && a.colorBytes == b.colorBytes &&
+                a.datum == b.datum && a.color == b.color &&
+                a.background == b.background && a.left == b.left &&
+                a.top == b.top && a.right == b.right &&
+                a.bottom == b.bottom &&
+                memcmp(a.v, b.v, sizeof(a.v)) == 0 && a.f[0] == b.f[0] &&
+                a.f[1] == b.f[1] && a.data == b.data;
+    if (same && a.type == DisplayCommandType::kText) {
+      same = isTextEqual(a, other, b);
+    }
+    if (!same) {
+      unite(left, top, right, bottom, a);
+      unite(left, top, right, bottom, b);
+    }
+  }
+  return toRect(left, top, right, bottom);
+}
+
+void DisplayList::render(M5Canvas *canvas, BoundingRect area,
+                         int32_t offset_y, int32_t offset_x) const {
+  // visible region in face coordinates
+  int32_t area_left = std::max<int32_t>(area.getLeft(), offset_x);
+  int32_t area_top = std::max<int32_t>(area.getTop(), offset_y);
+  int32_t area_right =
+      std::min<int32_t>(area.getRight(), offset_x + canvas->width());
+  int32_t area_bottom =
+      std::min<int32_t>(area.getBottom(), offset_y + canvas->height());
+  if (area_right <= area_left || area_bottom <= area_top) {
+    return;
+  }
+  int32_t left = area_left;
+  int32_t top = area_top;
+  int32_t right = area_right;
+  int32_t bottom = area_bottom;
+  canvas->setClipRect(left - offset_x, top - offset_y, right - left,
+                      bottom - top);
+  const char *string = text.data();
+  for (const auto &c : commands) {
+    if (c.type == DisplayCommandType::kClip) {
+      left = area_left;
+      top = area_top;
+      right = area_right;
+      bottom = area_bottom;
+      if (c.v[0] != 0) {
+        left = std::max<int32_t>(left, c.left);
+        top = std::max<int32_t>(top, c.top);
+        right = std::min<int32_t>(right, c.right);
+        bottom = std::min<int32_t>(bottom, c.bottom);
+      }
+      canvas->setClipRect(left - offset_x, top - offset_y,
+                          std::max<int32_t>(0, right - left),
+                          std::max<int32_t>(0, bottom - top));
+      continue;
+    }
+    // cull commands outside of the clip
+    if (c.right <= left || right <= c.left || c.bottom <= top ||
+        bottom <= c.top) {
+      continue;
+    }
+    switch (c.colorBytes) {
+      case 1:
+        renderCommand(canvas, c, offset_x, offset_y, string,
+                      static_cast<uint8_t>(c.color));
+        break;
+      case 2:
+        renderCommand(canvas, c, offset_x, offset_y, string,
+                      static_cast<uint16_t>(c.color));
+        break;
+      default:
+        renderCommand(canvas, c, offset_x, offset_y, string, c.color);
+        break;
+    }
+  }
+  canvas->clearClipRect();
+}
+
+}  // namespace m5avatar
@@ -0,0 +1,293 @@
+/**
+ * @file DisplayList.hpp
+ * @brief retained list of drawing primitives emitted by face parts
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef M5AVATAR_DISPLAY_LIST_HPP_
+#define M5AVATAR_DISPLAY_LIST_HPP_
+
+#include <M5GFX.h>
+
+#include <type_traits>
+#include <vector>
+
+#include "BoundingRect.h"
+
+namespace m5avatar {
+
+enum class DisplayCommandType : uint8_t {
+  kClip = 0,
+  kFillRect,
+  kDrawRect,
+  kFillCircle,
+  kDrawCircle,
+  kFillEllipse,
+  kFillTriangle,
+  kDrawLine,
+  kFillArc,
+  kDrawArc,
+  kFloodFill,
+  kText
+};
+
+/**
+ * @brief one drawing primitive
+ *
+ * Coordinates are in face coordinates. left/top/right/bottom is the bounding
+ * box of pixels the command may touch (right and bottom are exclusive).
+ */
+struct DisplayCommand {
+  DisplayCommandType type;
+  // bytes of the color type given to the command. LGFX reads 1 byte as
+  // RGB332, 2 bytes and signed integers (int such as TFT_RED) as RGB565 and
+  // 4 unsigned bytes as RGB888 (or palette index)
+  uint8_t colorBytes;
+  uint8_t datum;
+  uint32_t color;
+  uint32_t background;
+  int16_t left;
+  int16_t top;
+  int16_t right;
+  int16_t bottom;
+  int16_t v[6];
+  float f[2];
+  const void *data;
+};
+
+/**
+ * @brief command buffer of drawing primitives
+ *
+ * The list has the same drawing functions as M5Canvas used by face parts, so
+ * that parts can draw either into a canvas or into the list. Recorded
+ * commands keep the order of drawing and are rasterized with render().
+ *
+ * Memory for commands is reserved by reserve(). When the list is full,
+ * further commands are dropped and isOverflowed() returns true.
+ */
+class DisplayList {
+ private:
+  // sprite without buffer to measure text. created on the first use and
+  // owned by one list, so that lists drawn in different tasks do not share
+  // its font state. a copy creates its own
+  class TextMeasure {
+   private:
+    M5Canvas *canvas;
+
+   public:
+    TextMeasure() : canvas{nullptr} {}
+    ~TextMeasure() { reset(); }
+    TextMeasure(const TextMeasure &other) : TextMeasure() {}
+    TextMeasure &operator=(const TextMeasure &other) { return *this; }
+    M5Canvas *get();
+    void reset();
+  };
+
+  std::vector<DisplayCommand> commands;
+  // text of kText commands
+  std::vector<char> text;
+  bool overflowed;
+  bool unbounded;
+
+  // clip rect set by setClipRect()
+  bool clipped;
+  int16_t clipLeft;
+  int16_t clipTop;
+  int16_t clipRight;
+  int16_t clipBottom;
+
+  // text state
+  float textSize;
+  uint8_t textDatum;
+  uint32_t textColor;
+  uint32_t textBackground;
+  uint8_t textColorBytes;
+  const lgfx::IFont *font;
+  TextMeasure measure;
+
+  template <typename T>
+  static uint8_t colorBytes(const T &) {
+    // LGFX converts int colors, e.g. TFT_RED, from RGB565
+    return std::is_integral<T>::value && std::is_signed<T>::value &&
+                   sizeof(T) >= 2
+               ? 2
+           : sizeof(T) >= 3 ? 4
+                            : sizeof(T);
+  }
+
+  DisplayCommand *add(DisplayCommandType type, uint32_t color, uint8_t bytes,
+                      int32_t left, int32_t top, int32_t right,
+                      int32_t bottom);
+  void addArc(DisplayCommandType type, int32_t x, int32_t y, int32_t r0,
+              int32_t r1, float angle0, float angle1, uint32_t color,
+              uint8_t bytes);
+  bool isTextEqual(const DisplayCommand &a, const DisplayList &other,
+                   const DisplayCommand &b) const;
+
+ public:
+  // enough for built-in faces with a balloon, an effect and a battery icon
+  static constexpr size_t kDefaultCapacity = 64;
+  static constexpr size_t kDefaultTextCapacity = 128;
+
+  DisplayList();
+  ~DisplayList() = default;
+  DisplayList(const DisplayList &other) = default;
+  DisplayList &operator=(const DisplayList &other) = default;
+
+  /**
+   * @brief reserve memory for commands
+   *
+   * @param capacity max number of commands
+   * @param text_capacity max bytes of text including terminators
+   */
+  void reserve(size_t capacity, size_t text_capacity);
+
+  /**
+   * @brief release memory for commands
+   */
+  void release();
+
+  /**
+   * @brief remove all commands and reset the drawing state
+   */
+  void clear();
+
+  void swap(DisplayList &other);
+
+  size_t size() const { return commands.size(); }
+  const DisplayCommand &operator[](size_t i) const { return commands[i]; }
+
+  /**
+   * @brief commands were dropped since the last clear()
+   */
+  bool isOverflowed() const { return overflowed; }
+
+  /**
+   * @brief the list has a command without known bounds (floodFill)
+   *
+   * Such a list must be rendered into the whole frame at once.
+   */
+  bool hasUnboundedCommand() const { return unbounded; }
+
+  /**
+   * @brief union of bounds of all commands
+   *
+   * @return BoundingRect its size is 0 if the list is empty
+   */
+  BoundingRect getBounds() const;
+
+  /**
+   * @brief region which differs from another list
+   *
+   * Commands are compared in order. The result is the union of bounds of
+   * commands which differ, so it covers every pixel changed between the
+   * frames rendered from the lists.
+   *
+   * @param other list of the previous frame
+   * @return BoundingRect its size is 0 if the lists are the same
+   */
+  BoundingRect diff(const DisplayList &other) const;
+
+  /**
+   * @brief rasterize commands into a canvas
+   *
+   * Commands outside of the area are skipped. Each command is drawn clipped
+   * to the area.
+   *
+   * @param canvas destination
+   * @param area region to rasterize in face coordinates
+   * @param offset_y face row drawn at the top row of the canvas
+   * @param offset_x face column drawn at the left column of the canvas
+   */
+  void render(M5Canvas *canvas, BoundingRect area, int32_t offset_y = 0,
+              int32_t offset_x = 0) const;
+
+  // drawing functions compatible with M5Canvas
+  void setClipRect(int32_t x, int32_t y, int32_t w, int32_t h);
+  void clearClipRect();
+
+  template <typename T>
+  void fillRect(int32_t x, int32_t y, int32_t w, int32_t h, const T &color) {
+    addRect(DisplayCommandType::kFillRect, x, y, w, h, color,
+            colorBytes(color));
+  }
+  template <typename T>
+  void drawRect(int32_t x, int32_t y, int32_t w, int32_t h, const T &color) {
+    addRect(DisplayCommandType::kDrawRect, x, y, w, h, color,
+            colorBytes(color));
+  }
+  template <typename T>
+  void fillCircle(int32_t x, int32_t y, int32_t r, const T &color) {
+    addEllipse(DisplayCommandType::kFillCircle, x, y, r, r, color,
+               colorBytes(color));
+  }
+  template <typename T>
+  void drawCircle(int32_t x, int32_t y, int32_t r, const T &color) {
+    addEllipse(DisplayCommandType::kDrawCircle, x, y, r, r, color,
+               colorBytes(color));
+  }
+  template <typename T>
+  void fillEllipse(int32_t x, int32_t y, int32_t rx, int32_t ry,
+                   const T &color) {
+    addEllipse(DisplayCommandType::kFillEllipse, x, y, rx, ry, color,
+               colorBytes(color));
+  }
+  template <typename T>
+  void fillTriangle(int32_t x0, int32_t y0, int32_t x1, int32_t y1, int32_t x2,
+                    int32_t y2, const T &color) {
+    addTriangle(DisplayCommandType::kFillTriangle, x0, y0, x1, y1, x2, y2,
+                color, colorBytes(color));
+  }
+  template <typename T>
+  void drawLine(int32_t x0, int32_t y0, int32_t x1, int32_t y1,
+                const T &color) {
+    addTriangle(DisplayCommandType::kDrawLine, x0, y0, x1, y1, x1, y1, color,
+                colorBytes(color));
+  }
+  template <typename T>
+  void fillArc(int32_t x, int32_t y, int32_t r0, int32_t r1, float angle0,
+               float angle1, const T &color) {
+    addArc(DisplayCommandType::kFillArc, x, y, r0, r1, angle0, angle1, color,
+           colorBytes(color));
+  }
+  template <typename T>
+  void drawArc(int32_t x, int32_t y, int32_t r0, int32_t r1, float angle0,
+               float angle1, const T &color) {
+    addArc(DisplayCommandType::kDrawArc, x, y, r0, r1, angle0, angle1, color,
+           colorBytes(color));
+  }
+  template <typename T>
+  void floodFill(int32_t x, int32_t y, const T &color) {
+    addFloodFill(x, y, color, colorBytes(color));
+  }
+
+  void setTextSize(float size) { textSize = size; }
+  void setTextDatum(uint8_t datum) { textDatum = datum; }
+  template <typename T>
+  void setTextColor(T fg, T bg) {
+    textColor = fg;
+    textBackground = bg;
+    textColorBytes = colorBytes(fg);
+  }
+  void setFont(const lgfx::IFont *f) { font = f; }
+  // width of the text in the font and the text size set above
+  int32_t textWidth(const char *string);
+  void drawString(const char *string, int32_t x, int32_t y,
+                  const lgfx::IFont *f);
+
+  void addRect(DisplayCommandType type, int32_t x, int32_t y, int32_t w,
+               int32_t h, uint32_t color, uint8_t bytes);
+  void addEllipse(DisplayCommandType type, int32_t x, int32_t y, int32_t rx,
+                  int32_t ry, uint32_t color, uint8_t bytes);
+  void addTriangle(DisplayCommandType type, int32_t x0, int32_t y0,
+                   int32_t x1, int32_t y1, int32_t x2, int32_t y2,
+                   uint32_t color, uint8_t bytes);
+  void addFloodFill(int32_t x, int32_t y, uint32_t color, uint8_t bytes);
+};
+
+}  // namespace m5avatar
+
+#endif  // M5AVATAR_DISPLAY_LIST_HPP_
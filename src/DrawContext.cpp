@@ -10,7 +10,8 @@ DrawContext::DrawContext(Expression expression, float breath,
                          ColorPalette* const palette, Gaze rightGaze,
                          float rightEyeOpenRatio, Gaze leftGaze,
                          float leftEyeOpenRatio, float mouthOpenRatio,
-                         String speechText, BatteryIconStatus batteryIconStatus,
+                         const String& speechText,
+                         BatteryIconStatus batteryIconStatus,
                          int32_t batteryLevel, const lgfx::IFont* speechFont)
     : DrawContext(expression, breath, palette, rightGaze, rightEyeOpenRatio,
                   leftGaze, leftEyeOpenRatio, mouthOpenRatio, speechText, 0, 1,
@@ -20,7 +21,7 @@ DrawContext::DrawContext(Expression expression, float breath,
                          ColorPalette* const palette, Gaze rightGaze,
                          float rightEyeOpenRatio, Gaze leftGaze,
                          float leftEyeOpenRatio, float mouthOpenRatio,
-                         String speechText, float rotation, float scale,
+                         const String& speechText, float rotation, float scale,
                          int colorDepth, BatteryIconStatus batteryIconStatus,
                          int32_t batteryLevel, const lgfx::IFont* speechFont)
     : expression{expression},
@@ -31,6 +32,7 @@ DrawContext::DrawContext(Expression expression, float breath,
       leftEyeOpenRatio{leftEyeOpenRatio},
       mouthOpenRatio{mouthOpenRatio},
       palette{palette},
+      resolvedPalette{palette->resolve(colorDepth)},
       speechText{speechText},
       rotation{rotation},
       scale{scale},
@@ -57,10 +59,14 @@ float DrawContext::getRotation() const { return rotation; }
 
 float DrawContext::getScale() const { return scale; }
 
-String DrawContext::getspeechText() const { return speechText; }
+const String& DrawContext::getspeechText() const { return speechText; }
 
 ColorPalette* const DrawContext::getColorPalette() const { return palette; }
 
+const ColorPalette* DrawContext::getResolvedPalette() const {
+  return &resolvedPalette;
+}
+
 int DrawContext::getColorDepth() const { return colorDepth; }
 
 const lgfx::IFont* DrawContext::getSpeechFont() const { return speechFont; }
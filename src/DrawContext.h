@@ -34,7 +34,10 @@ class DrawContext {
   float mouthOpenRatio;
 
   ColorPalette* const palette;
-  String speechText;
+  // colors of palette resolved for colorDepth
+  ColorPalette resolvedPalette;
+  // NOTE: referenced, not copied. the text must outlive the context
+  const String& speechText;
   float rotation = 0.0;
   float scale = 1.0;
   int colorDepth = 1;
@@ -47,15 +50,15 @@ class DrawContext {
   DrawContext() = delete;
   DrawContext(Expression expression, float breath, ColorPalette* const palette,
               Gaze rightGaze, float rightEyeOpenRatio, Gaze leftGaze,
-              float leftEyeOpenRatio, float mouthOpenRatio, String speechText,
-              BatteryIconStatus batteryIconStatus, int32_t batteryLevel,
-              const lgfx::IFont* speechFont);
+              float leftEyeOpenRatio, float mouthOpenRatio,
+              const String& speechText, BatteryIconStatus batteryIconStatus,
+              int32_t batteryLevel, const lgfx::IFont* speechFont);
   DrawContext(Expression expression, float breath, ColorPalette* const palette,
               Gaze rightGaze, float rightEyeOpenRatio, Gaze leftGaze,
-              float leftEyeOpenRatio, float mouthOpenRatio, String speechText,
-              float rotation, float scale, int colorDepth,
-              BatteryIconStatus batteryIconStatus, int32_t batteryLevel,
-              const lgfx::IFont* speechFont);
+              float leftEyeOpenRatio, float mouthOpenRatio,
+              const String& speechText, float rotation, float scale,
+              int colorDepth, BatteryIconStatus batteryIconStatus,
+              int32_t batteryLevel, const lgfx::IFont* speechFont);
   ~DrawContext() = default;
   DrawContext(const DrawContext& other) = delete;
   DrawContext& operator=(const DrawContext& other) = delete;
@@ -69,7 +72,14 @@ class DrawContext {
   float getScale() const;
   float getRotation() const;
   ColorPalette* const getColorPalette() const;
-  String getspeechText() const;
+  /**
+   * @brief palette colors to draw parts with
+   *
+   * Colors are resolved for the color depth once per frame. See
+   * ColorPalette::resolve().
+   */
+  const ColorPalette* getResolvedPalette() const;
+  const String& getspeechText() const;
   int getColorDepth() const;
   BatteryIconStatus getBatteryIconStatus() const;
   int32_t getBatteryLevel() const;
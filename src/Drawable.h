@@ -7,6 +7,7 @@
 #define LGFX_USE_V1
 #include <M5GFX.h>
 #include "BoundingRect.h"
+#include "DisplayList.hpp"
 #include "DrawContext.h"
 
 namespace m5avatar {
@@ -15,6 +16,12 @@ class Drawable {
   virtual ~Drawable() = default;
   virtual void draw(M5Canvas *spi, BoundingRect rect,
                     DrawContext *drawContext) = 0;
+  // record drawing commands into the list instead of drawing.
+  // returns false if the drawable does not support recording
+  virtual bool record(DisplayList *list, BoundingRect rect,
+                      DrawContext *drawContext) {
+    return false;
+  }
   // virtual void draw(TFT_eSPI *spi, DrawContext *drawContext) = 0;
 };
 
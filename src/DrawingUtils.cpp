@@ -17,7 +17,8 @@ void rotatePointAround(float &x, float &y, float angle, float cx, float cy) {
   y = tmp_y + cy;
 }
 
-void fillRotatedRect(M5Canvas *canvas, uint16_t cx, uint16_t cy, uint16_t w,
+template <typename Canvas>
+void fillRotatedRect(Canvas *canvas, uint16_t cx, uint16_t cy, uint16_t w,
                      uint16_t h, float angle, uint16_t color) {
   float top_left_x = cx - w / 2;
   float top_left_y = cy - h / 2;
@@ -43,7 +44,8 @@ void fillRotatedRect(M5Canvas *canvas, uint16_t cx, uint16_t cy, uint16_t w,
                        bottom_left_x, bottom_left_y, color);
 }
 
-void fillRectRotatedAround(M5Canvas *canvas, float top_left_x, float top_left_y,
+template <typename Canvas>
+void fillRectRotatedAround(Canvas *canvas, float top_left_x, float top_left_y,
                            float bottom_right_x, float bottom_right_y,
                            float angle, uint16_t cx, uint16_t cy,
                            uint16_t color) {
@@ -137,7 +139,8 @@ void computeAnglesOfArcPassingThroughThreePoints(
   max_angle = std::max(angle1, angle2);
 }
 
-void drawCircle(M5Canvas *canvas, float x1, float y1, float x2, float y2,
+template <typename Canvas>
+void drawCircle(Canvas *canvas, float x1, float y1, float x2, float y2,
                 float x3, float y3, uint16_t color) {
   float r, cx, cy;
   computeParamsOfCirclePassingThroughThreePoints(r, cx, cy, x1, y1, x2, y2, x3,
@@ -145,7 +148,8 @@ void drawCircle(M5Canvas *canvas, float x1, float y1, float x2, float y2,
   canvas->drawCircle(cx, cy, r, color);
 }
 
-void drawArc(M5Canvas *canvas, float x1, float y1, float x2, float y2,
+template <typename Canvas>
+void drawArc(Canvas *canvas, float x1, float y1, float x2, float y2,
              float via_x, float via_y, uint8_t thickness, uint16_t color,
              uint8_t offset) {
   float r, cx, cy, angle1, angle2, via_angle;
@@ -174,7 +178,8 @@ void drawArc(M5Canvas *canvas, float x1, float y1, float x2, float y2,
   }
 }
 
-void fillArc(M5Canvas *canvas, float x1, float y1, float x2, float y2,
+template <typename Canvas>
+void fillArc(Canvas *canvas, float x1, float y1, float x2, float y2,
              float via_x, float via_y, uint8_t thickness, uint16_t color,
              uint8_t offset) {
   float r, cx, cy, angle1, angle2, via_angle;
@@ -204,4 +209,26 @@ void fillArc(M5Canvas *canvas, float x1, float y1, float x2, float y2,
   }
 }
 
+// drawing functions are used for both of immediate drawing and recording
+template void fillRotatedRect(M5Canvas *, uint16_t, uint16_t, uint16_t,
+                              uint16_t, float, uint16_t);
+template void fillRotatedRect(DisplayList *, uint16_t, uint16_t, uint16_t,
+                              uint16_t, float, uint16_t);
+template void fillRectRotatedAround(M5Canvas *, float, float, float, float,
+                                    float, uint16_t, uint16_t, uint16_t);
+template void fillRectRotatedAround(DisplayList *, float, float, float, float,
+                                    float, uint16_t, uint16_t, uint16_t);
+template void drawCircle(M5Canvas *, float, float, float, float, float, float,
+                         uint16_t);
+template void drawCircle(DisplayList *, float, float, float, float, float,
+                         float, uint16_t);
+template void drawArc(M5Canvas *, float, float, float, float, float, float,
+                      uint8_t, uint16_t, uint8_t);
+template void drawArc(DisplayList *, float, float, float, float, float, float,
+                      uint8_t, uint16_t, uint8_t);
+template void fillArc(M5Canvas *, float, float, float, float, float, float,
+                      uint8_t, uint16_t, uint8_t);
+template void fillArc(DisplayList *, float, float, float, float, float, float,
+                      uint8_t, uint16_t, uint8_t);
+
 }  // namespace m5avatar
\ No newline at end of file
@@ -14,6 +14,7 @@
 
 #include <BoundingRect.h>
 #include <DrawContext.h>
+#include <DisplayList.hpp>
 #include <Drawable.h>
 
 namespace m5avatar {
@@ -21,10 +22,12 @@ void rotatePoint(float &x, float &y, float angle);
 
 void rotatePointAround(float &x, float &y, float angle, float cx, float cy);
 
-void fillRotatedRect(M5Canvas *canvas, uint16_t cx, uint16_t cy, uint16_t w,
+template <typename Canvas>
+void fillRotatedRect(Canvas *canvas, uint16_t cx, uint16_t cy, uint16_t w,
                      uint16_t h, float angle, uint16_t color);
 
-void fillRectRotatedAround(M5Canvas *canvas, float top_left_x, float top_left_y,
+template <typename Canvas>
+void fillRectRotatedAround(Canvas *canvas, float top_left_x, float top_left_y,
                            float bottom_right_x, float bottom_right_y,
                            float angle, uint16_t cx, uint16_t cy,
                            uint16_t color);
@@ -52,13 +55,14 @@ void computeAnglesOfArcPassingThroughThreePoints(
     float &min_angle, float &max_angle, float &via_angle, float x1, float y1,
     float x2, float y2, float via_x, float via_y, float cx, float cy);
 
-void drawCircle(M5Canvas *canvas, float x1, float y1, float x2, float y2,
+template <typename Canvas>
+void drawCircle(Canvas *canvas, float x1, float y1, float x2, float y2,
                 float x3, float y3, uint16_t color);
 
 /**
  * @brief draw arc with three waypoints
  *
- * @param canvas
+ * @param canvas M5Canvas or DisplayList
  * @param x1
  * @param y1
  * @param x2
@@ -69,11 +73,13 @@ void drawCircle(M5Canvas *canvas, float x1, float y1, float x2, float y2,
  * @param clockwise
  * @param color
  */
-void drawArc(M5Canvas *canvas, float x1, float y1, float x2, float y2,
+template <typename Canvas>
+void drawArc(Canvas *canvas, float x1, float y1, float x2, float y2,
              float via_x, float via_y, uint8_t thickness = 4,
              uint16_t color = 0xffff, uint8_t offset = 0);
 
-void fillArc(M5Canvas *canvas, float x1, float y1, float x2, float y2,
+template <typename Canvas>
+void fillArc(Canvas *canvas, float x1, float y1, float x2, float y2,
              float via_x, float via_y, uint8_t thickness = 4,
              uint16_t color = 0xffff, uint8_t offset = 0);
 
@@ -14,24 +14,28 @@ namespace m5avatar {
 
 class Effect final : public Drawable {
  private:
-  void drawBubbleMark(M5Canvas *spi, uint32_t x, uint32_t y, uint32_t r,
+  template <typename T>
+  void drawBubbleMark(T *spi, uint32_t x, uint32_t y, uint32_t r,
                       uint16_t color) {
     drawBubbleMark(spi, x, y, r, color, 0);
   }
 
-  void drawBubbleMark(M5Canvas *spi, uint32_t x, uint32_t y, uint32_t r,
+  template <typename T>
+  void drawBubbleMark(T *spi, uint32_t x, uint32_t y, uint32_t r,
                       uint16_t color, float offset) {
     r = r + floor(r * 0.2 * offset);
     spi->drawCircle(x, y, r, color);
     spi->drawCircle(x - (r / 4), y - (r / 4), r / 4, color);
   }
 
-  void drawSweatMark(M5Canvas *spi, uint32_t x, uint32_t y, uint32_t r,
+  template <typename T>
+  void drawSweatMark(T *spi, uint32_t x, uint32_t y, uint32_t r,
                      uint16_t color) {
     drawSweatMark(spi, x, y, r, color, 0);
   }
 
-  void drawSweatMark(M5Canvas *spi, uint32_t x, uint32_t y, uint32_t r,
+  template <typename T>
+  void drawSweatMark(T *spi, uint32_t x, uint32_t y, uint32_t r,
                      uint16_t color, float offset) {
     y = y + floor(5 * offset);
     r = r + floor(r * 0.2 * offset);
@@ -41,12 +45,14 @@ class Effect final : public Drawable {
                       color);
   }
 
-  void drawChillMark(M5Canvas *spi, uint32_t x, uint32_t y, uint32_t r,
+  template <typename T>
+  void drawChillMark(T *spi, uint32_t x, uint32_t y, uint32_t r,
                      uint16_t color) {
     drawChillMark(spi, x, y, r, color, 0);
   }
 
-  void drawChillMark(M5Canvas *spi, uint32_t x, uint32_t y, uint32_t r,
+  template <typename T>
+  void drawChillMark(T *spi, uint32_t x, uint32_t y, uint32_t r,
                      uint16_t color, float offset) {
     uint32_t h = r + abs(r * 0.2 * offset);
     spi->fillRect(x - (r / 2), y, 3, h / 2, color);
@@ -54,12 +60,14 @@ class Effect final : public Drawable {
     spi->fillRect(x + (r / 2), y, 3, h, color);
   }
 
-  void drawAngerMark(M5Canvas *spi, uint32_t x, uint32_t y, uint32_t r,
+  template <typename T>
+  void drawAngerMark(T *spi, uint32_t x, uint32_t y, uint32_t r,
                      uint16_t color, uint32_t bColor) {
     drawAngerMark(spi, x, y, r, color, bColor, 0);
   }
 
-  void drawAngerMark(M5Canvas *spi, uint32_t x, uint32_t y, uint32_t r,
+  template <typename T>
+  void drawAngerMark(T *spi, uint32_t x, uint32_t y, uint32_t r,
                      uint16_t color, uint16_t bColor, float offset) {
     r = r + abs(r * 0.4 * offset);
     spi->fillRect(x - (r / 3), y - r, (r * 2) / 3, r * 2, color);
@@ -68,12 +76,14 @@ class Effect final : public Drawable {
     spi->fillRect(x - r, y - (r / 3) + 2, r * 2, ((r * 2) / 3) - 4, bColor);
   }
 
-  void drawHeartMark(M5Canvas *spi, uint32_t x, uint32_t y, uint32_t r,
+  template <typename T>
+  void drawHeartMark(T *spi, uint32_t x, uint32_t y, uint32_t r,
                      uint16_t color) {
     drawHeartMark(spi, x, y, r, color, 0);
   }
 
-  void drawHeartMark(M5Canvas *spi, uint32_t x, uint32_t y, uint32_t r,
+  template <typename T>
+  void drawHeartMark(T *spi, uint32_t x, uint32_t y, uint32_t r,
                      uint16_t color, float offset) {
     r = r + floor(r * 0.4 * offset);
     spi->fillCircle(x - r / 2, y, r / 2, color);
@@ -84,19 +94,10 @@ class Effect final : public Drawable {
                       x + r / 2 + a, y + a, color);
   }
 
- public:
-  // constructor
-  Effect() = default;
-  ~Effect() = default;
-  Effect(const Effect &other) = default;
-  Effect &operator=(const Effect &other) = default;
-  void draw(M5Canvas *spi, BoundingRect rect, DrawContext *ctx) override {
-    uint16_t primaryColor = ctx->getColorDepth() == 1
-                                ? 1
-                                : ctx->getColorPalette()->get(COLOR_PRIMARY);
-    uint16_t bgColor = ctx->getColorDepth() == 1
-                           ? ERACER_COLOR
-                           : ctx->getColorPalette()->get(COLOR_BACKGROUND);
+  template <typename T>
+  void render(T *spi, BoundingRect rect, DrawContext *ctx) {
+    uint16_t primaryColor = ctx->getResolvedPalette()->get(COLOR_PRIMARY);
+    uint16_t bgColor = ctx->getResolvedPalette()->get(COLOR_BACKGROUND);
     float offset = ctx->getBreath();
     Expression exp = ctx->getExpression();
     switch (exp) {
@@ -121,6 +122,21 @@ class Effect final : public Drawable {
         break;
     }
   }
+
+ public:
+  // constructor
+  Effect() = default;
+  ~Effect() = default;
+  Effect(const Effect &other) = default;
+  Effect &operator=(const Effect &other) = default;
+  void draw(M5Canvas *spi, BoundingRect rect, DrawContext *ctx) override {
+    render(spi, rect, ctx);
+  }
+  bool record(DisplayList *list, BoundingRect rect,
+              DrawContext *ctx) override {
+    render(list, rect, ctx);
+    return true;
+  }
 };
 
 }  // namespace m5avatar
@@ -10,7 +10,8 @@ Eye::Eye(uint16_t x, uint16_t y, uint16_t r, bool isLeft) : Eye(r, isLeft) {}
 
 Eye::Eye(uint16_t r, bool isLeft) : r{r}, isLeft{isLeft} {}
 
-void Eye::draw(M5Canvas *spi, BoundingRect rect, DrawContext *ctx) {
+template <typename T>
+void Eye::render(T *spi, BoundingRect rect, DrawContext *ctx) {
   Expression exp = ctx->getExpression();
   uint32_t x = rect.getCenterX();
   uint32_t y = rect.getCenterY();
@@ -19,12 +20,8 @@ void Eye::draw(M5Canvas *spi, BoundingRect rect, DrawContext *ctx) {
       this->isLeft ? ctx->getLeftEyeOpenRatio() : ctx->getRightEyeOpenRatio();
   uint32_t offsetX = g.getHorizontal() * 3;
   uint32_t offsetY = g.getVertical() * 3;
-  uint16_t primaryColor = ctx->getColorDepth() == 1
-                              ? 1
-                              : ctx->getColorPalette()->get(COLOR_PRIMARY);
-  uint16_t backgroundColor =
-      ctx->getColorDepth() == 1 ? 0
-                                : ctx->getColorPalette()->get(COLOR_BACKGROUND);
+  uint16_t primaryColor = ctx->getResolvedPalette()->get(COLOR_PRIMARY);
+  uint16_t backgroundColor = ctx->getResolvedPalette()->get(COLOR_BACKGROUND);
 
   if (openRatio > 0) {
     spi->fillCircle(x + offsetX, y + offsetY, r, primaryColor);
@@ -59,4 +56,13 @@ void Eye::draw(M5Canvas *spi, BoundingRect rect, DrawContext *ctx) {
     spi->fillRect(x1, y1, w, h, primaryColor);
   }
 }
+
+void Eye::draw(M5Canvas *spi, BoundingRect rect, DrawContext *ctx) {
+  render(spi, rect, ctx);
+}
+
+bool Eye::record(DisplayList *list, BoundingRect rect, DrawContext *ctx) {
+  render(list, rect, ctx);
+  return true;
+}
 }  // namespace m5avatar
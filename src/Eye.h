@@ -16,6 +16,8 @@ class Eye final : public Drawable {
  private:
   uint16_t r;
   bool isLeft;
+  template <typename T>
+  void render(T *spi, BoundingRect rect, DrawContext *drawContext);
 
  public:
   // constructor
@@ -27,6 +29,8 @@ class Eye final : public Drawable {
   Eye &operator=(const Eye &other) = default;
   void draw(M5Canvas *spi, BoundingRect rect,
             DrawContext *drawContext) override;
+  bool record(DisplayList *list, BoundingRect rect,
+              DrawContext *drawContext) override;
   // void draw(TFT_eSPI *spi, DrawContext *drawContext) override; // deprecated
 };
 
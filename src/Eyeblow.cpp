@@ -8,13 +8,12 @@ namespace m5avatar {
 Eyeblow::Eyeblow(uint16_t w, uint16_t h, bool isLeft)
     : width{w}, height{h}, isLeft{isLeft} {}
 
-void Eyeblow::draw(M5Canvas *spi, BoundingRect rect, DrawContext *ctx) {
+template <typename T>
+void Eyeblow::render(T *spi, BoundingRect rect, DrawContext *ctx) {
   Expression exp = ctx->getExpression();
   uint32_t x = rect.getLeft();
   uint32_t y = rect.getTop();
-  uint16_t primaryColor = ctx->getColorDepth() == 1
-                              ? 1
-                              : ctx->getColorPalette()->get(COLOR_PRIMARY);
+  uint16_t primaryColor = ctx->getResolvedPalette()->get(COLOR_PRIMARY);
   if (width == 0 || height == 0) {
     return;
   }
@@ -44,4 +43,13 @@ void Eyeblow::draw(M5Canvas *spi, BoundingRect rect, DrawContext *ctx) {
   }
 }
 
+void Eyeblow::draw(M5Canvas *spi, BoundingRect rect, DrawContext *ctx) {
+  render(spi, rect, ctx);
+}
+
+bool Eyeblow::record(DisplayList *list, BoundingRect rect, DrawContext *ctx) {
+  render(list, rect, ctx);
+  return true;
+}
+
 }  // namespace m5avatar
@@ -17,6 +17,8 @@ class Eyeblow final : public Drawable {
   uint16_t width;
   uint16_t height;
   bool isLeft;
+  template <typename T>
+  void render(T *spi, BoundingRect rect, DrawContext *drawContext);
 
  public:
   // constructor
@@ -27,6 +29,8 @@ class Eyeblow final : public Drawable {
   Eyeblow &operator=(const Eyeblow &other) = default;
   void draw(M5Canvas *spi, BoundingRect rect,
             DrawContext *drawContext) override;
+  bool record(DisplayList *list, BoundingRect rect,
+              DrawContext *drawContext) override;
 };
 
 }  // namespace m5avatar
@@ -12,24 +12,24 @@ BaseEyebrow::BaseEyebrow(uint16_t width, uint16_t height, bool is_left) {
 
 void BaseEyebrow::update(M5Canvas *canvas, BoundingRect rect,
                          DrawContext *ctx) {
+  update(rect, ctx);
+}
+
+void BaseEyebrow::update(BoundingRect rect, DrawContext *ctx) {
   // common process for all standard eyebrows
   // update drawing parameters
-  palette_ = ctx->getColorPalette();
-  primary_color_ = ctx->getColorDepth() == 1 ? 1 : palette_->get(COLOR_PRIMARY);
-  secondary_color_ = ctx->getColorDepth() == 1
-                         ? 1
-                         : ctx->getColorPalette()->get(COLOR_SECONDARY);
-  background_color_ = ctx->getColorDepth() == 1
-                          ? ERACER_COLOR
-                          : palette_->get(COLOR_BACKGROUND);
+  palette_ = ctx->getResolvedPalette();
+  primary_color_ = palette_->get(COLOR_PRIMARY);
+  secondary_color_ = palette_->get(COLOR_SECONDARY);
+  background_color_ = palette_->get(COLOR_BACKGROUND);
   center_x_ = rect.getCenterX();
   center_y_ = rect.getCenterY();
   expression_ = ctx->getExpression();
 }
 
-void EllipseEyebrow::draw(M5Canvas *canvas, BoundingRect rect,
-                          DrawContext *ctx) {
-  this->update(canvas, rect, ctx);
+template <typename T>
+void EllipseEyebrow::render(T *canvas, BoundingRect rect, DrawContext *ctx) {
+  this->update(rect, ctx);
   if (width_ == 0 || height_ == 0) {
     return;  // draw nothing
   }
@@ -38,8 +38,24 @@ void EllipseEyebrow::draw(M5Canvas *canvas, BoundingRect rect,
                       primary_color_);
 }
 
-void BowEyebrow::draw(M5Canvas *canvas, BoundingRect rect, DrawContext *ctx) {
-  this->update(canvas, rect, ctx);
+void EllipseEyebrow::draw(M5Canvas *canvas, BoundingRect rect,
+                          DrawContext *ctx) {
+  if (drawCached(this, &EllipseEyebrow::render<DisplayList>, canvas, rect,
+                 ctx)) {
+    return;
+  }
+  render(canvas, rect, ctx);
+}
+
+bool EllipseEyebrow::record(DisplayList *list, BoundingRect rect,
+                            DrawContext *ctx) {
+  render(list, rect, ctx);
+  return true;
+}
+
+template <typename T>
+void BowEyebrow::render(T *canvas, BoundingRect rect, DrawContext *ctx) {
+  this->update(rect, ctx);
 
   if (!palette_->contains(DrawingLocation::kEyeBrow)) {
     return;
@@ -55,8 +71,22 @@ void BowEyebrow::draw(M5Canvas *canvas, BoundingRect rect, DrawContext *ctx) {
           center_x_, center_y_ - height_ / 2, thickness, color);
 }
 
-void RectEyebrow::draw(M5Canvas *canvas, BoundingRect rect, DrawContext *ctx) {
-  this->update(canvas, rect, ctx);
+void BowEyebrow::draw(M5Canvas *canvas, BoundingRect rect, DrawContext *ctx) {
+  if (drawCached(this, &BowEyebrow::render<DisplayList>, canvas, rect, ctx)) {
+    return;
+  }
+  render(canvas, rect, ctx);
+}
+
+bool BowEyebrow::record(DisplayList *list, BoundingRect rect,
+                        DrawContext *ctx) {
+  render(list, rect, ctx);
+  return true;
+}
+
+template <typename T>
+void RectEyebrow::render(T *canvas, BoundingRect rect, DrawContext *ctx) {
+  this->update(rect, ctx);
 
   if (width_ == 0 || height_ == 0) {
     return;
@@ -73,4 +103,17 @@ void RectEyebrow::draw(M5Canvas *canvas, BoundingRect rect, DrawContext *ctx) {
                   primary_color_);
 }
 
+void RectEyebrow::draw(M5Canvas *canvas, BoundingRect rect, DrawContext *ctx) {
+  if (drawCached(this, &RectEyebrow::render<DisplayList>, canvas, rect, ctx)) {
+    return;
+  }
+  render(canvas, rect, ctx);
+}
+
+bool RectEyebrow::record(DisplayList *list, BoundingRect rect,
+                         DrawContext *ctx) {
+  render(list, rect, ctx);
+  return true;
+}
+
 }  // namespace m5avatar
@@ -17,6 +17,7 @@
 #include <Drawable.h>
 
 #include "DrawingUtils.hpp"
+#include "RasterCache.hpp"
 namespace m5avatar {
 class BaseEyebrow : public Drawable {
  protected:
@@ -25,7 +26,7 @@ class BaseEyebrow : public Drawable {
   bool is_left_;
 
   // caches
-  ColorPalette *palette_;
+  const ColorPalette *palette_;
   uint16_t primary_color_;
   uint16_t secondary_color_;
   uint16_t background_color_;
@@ -33,29 +34,80 @@ class BaseEyebrow : public Drawable {
   int16_t center_y_;
   Expression expression_;
 
+  RasterCache raster_cache_;
+
+  /**
+   * @brief draw the eyebrow through the raster cache
+   *
+   * @param part eyebrow drawn by this function
+   * @param render function recording the eyebrow into a display list
+   * @return false when the cache is disabled and nothing is drawn
+   */
+  template <typename Part>
+  bool drawCached(Part *part,
+                  void (Part::*render)(DisplayList *, BoundingRect,
+                                       DrawContext *),
+                  M5Canvas *canvas, BoundingRect rect, DrawContext *ctx) {
+    if (!raster_cache_.isEnabled()) {
+      return false;
+    }
+    update(rect, ctx);
+    // eyebrows change only with expression
+    uint32_t key = static_cast<uint32_t>(expression_);
+    if (!raster_cache_.draw(canvas, key, center_x_, center_y_, ctx)) {
+      (part->*render)(raster_cache_.record(), rect, ctx);
+      raster_cache_.store(canvas, key, center_x_, center_y_, ctx);
+    }
+    return true;
+  }
+
  public:
   BaseEyebrow(bool is_left);
   BaseEyebrow(uint16_t width, uint16_t height, bool is_left);
   void update(M5Canvas *canvas, BoundingRect rect, DrawContext *ctx);
+  void update(BoundingRect rect, DrawContext *ctx);
+
+  /**
+   * @brief cache rasterized eyebrows up to the budget
+   *
+   * @param bytes max bytes of cached sprites. 0 disables the cache
+   */
+  void setRasterCacheBudget(size_t bytes) { raster_cache_.setBudget(bytes); }
+  const RasterCache *getRasterCache() const { return &raster_cache_; }
 };
 
 // Maro Mayu
 class EllipseEyebrow : public BaseEyebrow {
+ protected:
+  template <typename T>
+  void render(T *canvas, BoundingRect rect, DrawContext *ctx);
+
  public:
   using BaseEyebrow::BaseEyebrow;
   void draw(M5Canvas *canvas, BoundingRect rect, DrawContext *ctx);
+  bool record(DisplayList *list, BoundingRect rect, DrawContext *ctx);
 };
 
 class BowEyebrow : public BaseEyebrow {
+ protected:
+  template <typename T>
+  void render(T *canvas, BoundingRect rect, DrawContext *ctx);
+
  public:
   using BaseEyebrow::BaseEyebrow;
   void draw(M5Canvas *canvas, BoundingRect rect, DrawContext *ctx);
+  bool record(DisplayList *list, BoundingRect rect, DrawContext *ctx);
 };
 
 class RectEyebrow : public BaseEyebrow {
+ protected:
+  template <typename T>
+  void render(T *canvas, BoundingRect rect, DrawContext *ctx);
+
  public:
   using BaseEyebrow::BaseEyebrow;
   void draw(M5Canvas *canvas, BoundingRect rect, DrawContext *ctx);
+  bool record(DisplayList *list, BoundingRect rect, DrawContext *ctx);
 };
 
 }  // namespace m5avatar
@@ -2,6 +2,13 @@
 
 namespace m5avatar {
 
+namespace {
+
+// quantization of open ratio for the raster cache
+constexpr float kOpenRatioSteps = 16.0f;
+
+}  // namespace
+
 void drawStraightEyelid(M5Canvas *canvas, int16_t cx, int16_t cy, int16_t width,
                         int16_t height, int16_t tilt, ColorPalette *palette) {
   auto skin_color = palette->get(DrawingLocation::kSkin);
@@ -16,32 +23,47 @@ BaseEye::BaseEye(uint16_t width, uint16_t height, bool is_left) {
 }
 
 void BaseEye::update(M5Canvas *canvas, BoundingRect rect, DrawContext *ctx) {
+  update(rect, ctx);
+}
+
+void BaseEye::update(BoundingRect rect, DrawContext *ctx) {
   // common process for all standard eyes
   // update drawing parameters
   center_x_ = rect.getCenterX();
   center_y_ = rect.getCenterY();
   gaze_ = this->is_left_ ? ctx->getLeftGaze() : ctx->getRightGaze();
-  palette_ = ctx->getColorPalette();
+  palette_ = ctx->getResolvedPalette();
 
   // cache of required colors
   // ctx->getColorDepth() == 1 : binary mode (black & white)
-  iris_bg_color_ = ctx->getColorDepth() == 1
-                       ? 1
-                       : palette_->get(DrawingLocation::kIrisBackground);
-  skin_color_ = ctx->getColorDepth() == 1
-                    ? ERACER_COLOR
-                    : palette_->get(DrawingLocation::kSkin);
+  iris_bg_color_ = palette_->get(DrawingLocation::kIrisBackground);
+  skin_color_ = palette_->get(DrawingLocation::kSkin);
 
   // iris position computed from gaze direction
   iris_x_ = center_x_ + gaze_.getHorizontal() * 4;
   iris_y_ = center_y_ + gaze_.getVertical() * 2;
   open_ratio_ =
       this->is_left_ ? ctx->getLeftEyeOpenRatio() : ctx->getRightEyeOpenRatio();
+  if (raster_cache_.isEnabled()) {
+    // limit the number of cached states
+    open_ratio_ = roundf(open_ratio_ * kOpenRatioSteps) / kOpenRatioSteps;
+  }
   expression_ = ctx->getExpression();
 }
 
-void EllipseEye::draw(M5Canvas *canvas, BoundingRect rect, DrawContext *ctx) {
-  this->update(canvas, rect, ctx);
+uint32_t BaseEye::rasterKey() const {
+  // iris offset is integer pixels, so it is exact without quantization
+  uint8_t open_step = static_cast<uint8_t>(open_ratio_ * kOpenRatioSteps);
+  uint8_t dx = static_cast<uint8_t>(iris_x_ - center_x_);
+  uint8_t dy = static_cast<uint8_t>(iris_y_ - center_y_);
+  return (static_cast<uint32_t>(expression_) << 24) |
+         (static_cast<uint32_t>(open_step) << 16) |
+         (static_cast<uint32_t>(dx) << 8) | dy;
+}
+
+template <typename T>
+void EllipseEye::render(T *canvas, BoundingRect rect, DrawContext *ctx) {
+  this->update(rect, ctx);
   if (open_ratio_ == 0 || expression_ == Expression::kSleepy) {
     // eye closed
     // NOTE: the center of closed eye is lower than the center of bbox
@@ -107,9 +129,23 @@ void EllipseEye::draw(M5Canvas *canvas, BoundingRect rect, DrawContext *ctx) {
   }
 }
 
+void EllipseEye::draw(M5Canvas *canvas, BoundingRect rect, DrawContext *ctx) {
+  if (drawCached(this, &EllipseEye::render<DisplayList>, canvas, rect, ctx)) {
+    return;
+  }
+  render(canvas, rect, ctx);
+}
+
+bool EllipseEye::record(DisplayList *list, BoundingRect rect,
+                        DrawContext *ctx) {
+  render(list, rect, ctx);
+  return true;
+}
+
 void ToonEye1::update2(M5Canvas *canvas, BoundingRect rect, DrawContext *ctx) {}
 
-void ToonEye1::drawEyelid(M5Canvas *canvas) {
+template <typename T>
+void ToonEye1::drawEyelid(T *canvas) {
   if (!palette_->contains(DrawingLocation::kEyelid)) {
     return;
   }
@@ -260,9 +296,10 @@ void ToonEye1::overwriteOpenRatio() {
   }
 }
 
-void ToonEye1::draw(M5Canvas *canvas, BoundingRect rect, DrawContext *ctx) {
+template <typename T>
+void ToonEye1::render(T *canvas, BoundingRect rect, DrawContext *ctx) {
   // NOTE https://comic.smiles55.jp/guide/9879/
-  this->update(canvas, rect, ctx);
+  this->update(rect, ctx);
   this->overwriteOpenRatio();
   // 0.2f is offset for natural eye opening. Usually, eyebrow overlap iris
   // approx 20 %
@@ -286,7 +323,7 @@ void ToonEye1::draw(M5Canvas *canvas, BoundingRect rect, DrawContext *ctx) {
   //   return;
   // }
   // iris
-  palette_ = ctx->getColorPalette();
+  palette_ = ctx->getResolvedPalette();
 
   // main eye
   if (open_ratio_ > 0.1f) {
@@ -305,7 +342,17 @@ void ToonEye1::draw(M5Canvas *canvas, BoundingRect rect, DrawContext *ctx) {
       canvas->fillRect(iris_x_ - width_ / 2 + thickness, iris_y_,
                        width_ - 2 * thickness + 1, 1, iris_color_2);
       // lower half moon will be filled
-      canvas->floodFill(iris_x_, iris_y_ + 2, iris_color_2);
+      if (palette_->contains(DrawingLocation::kIris1)) {
+        // the half moon is the lower half of the inner ellipse. draw it with
+        // bounded primitives so that the eye can be rasterized in strips
+        canvas->setClipRect(iris_x_ - iris_w / 2, iris_y_ + 1, iris_w,
+                            iris_h / 2);
+        canvas->fillEllipse(iris_x_, iris_y_, iris_w / 2 - thickness,
+                            iris_h / 2 - thickness, iris_color_2);
+        canvas->clearClipRect();
+      } else {
+        canvas->floodFill(iris_x_, iris_y_ + 2, iris_color_2);
+      }
     }
     // pupil
     if (palette_->contains(DrawingLocation::kPupil)) {
@@ -326,7 +373,20 @@ void ToonEye1::draw(M5Canvas *canvas, BoundingRect rect, DrawContext *ctx) {
   this->drawEyelid(canvas);
 }
 
-void ToonEye2::drawEyelid(M5Canvas *canvas) {
+void ToonEye1::draw(M5Canvas *canvas, BoundingRect rect, DrawContext *ctx) {
+  if (drawCached(this, &ToonEye1::render<DisplayList>, canvas, rect, ctx)) {
+    return;
+  }
+  render(canvas, rect, ctx);
+}
+
+bool ToonEye1::record(DisplayList *list, BoundingRect rect, DrawContext *ctx) {
+  render(list, rect, ctx);
+  return true;
+}
+
+template <typename T>
+void ToonEye2::drawEyelid(T *canvas) {
   // rect eyelid
   auto upper_eyelid_y =
       iris_y_ - 0.8f * height_ / 2 + (1.0f - open_ratio_) * this->height_ * 0.6;
@@ -407,8 +467,9 @@ void ToonEye2::overwriteOpenRatio() {
   }
 }
 
-void ToonEye2::draw(M5Canvas *canvas, BoundingRect rect, DrawContext *ctx) {
-  this->update(canvas, rect, ctx);
+template <typename T>
+void ToonEye2::render(T *canvas, BoundingRect rect, DrawContext *ctx) {
+  this->update(rect, ctx);
   this->overwriteOpenRatio();
   auto wink_base_y = iris_y_ + (1.0f - open_ratio_ + 0.2f) * this->height_ / 4;
 
@@ -466,7 +527,20 @@ void ToonEye2::draw(M5Canvas *canvas, BoundingRect rect, DrawContext *ctx) {
   }
 }
 
-void PinkDemonEye::drawEyelid(M5Canvas *canvas) {
+void ToonEye2::draw(M5Canvas *canvas, BoundingRect rect, DrawContext *ctx) {
+  if (drawCached(this, &ToonEye2::render<DisplayList>, canvas, rect, ctx)) {
+    return;
+  }
+  render(canvas, rect, ctx);
+}
+
+bool ToonEye2::record(DisplayList *list, BoundingRect rect, DrawContext *ctx) {
+  render(list, rect, ctx);
+  return true;
+}
+
+template <typename T>
+void PinkDemonEye::drawEyelid(T *canvas) {
   // eyelid
   auto upper_eyelid_y =
       iris_y_ - 0.8f * height_ / 2 + (1.0f - open_ratio_) * this->height_ * 0.6;
@@ -529,8 +603,9 @@ void PinkDemonEye::overwriteOpenRatio() {
   }
 }
 
-void PinkDemonEye::draw(M5Canvas *canvas, BoundingRect rect, DrawContext *ctx) {
-  this->update(canvas, rect, ctx);
+template <typename T>
+void PinkDemonEye::render(T *canvas, BoundingRect rect, DrawContext *ctx) {
+  this->update(rect, ctx);
   this->overwriteOpenRatio();
   uint32_t thickness = 8;
 
@@ -557,8 +632,23 @@ void PinkDemonEye::draw(M5Canvas *canvas, BoundingRect rect, DrawContext *ctx) {
   this->drawEyelid(canvas);
 }
 
-void DoggyEye::draw(M5Canvas *canvas, BoundingRect rect, DrawContext *ctx) {
-  this->update(canvas, rect, ctx);
+void PinkDemonEye::draw(M5Canvas *canvas, BoundingRect rect, DrawContext *ctx) {
+  if (drawCached(this, &PinkDemonEye::render<DisplayList>, canvas, rect,
+                 ctx)) {
+    return;
+  }
+  render(canvas, rect, ctx);
+}
+
+bool PinkDemonEye::record(DisplayList *list, BoundingRect rect,
+                          DrawContext *ctx) {
+  render(list, rect, ctx);
+  return true;
+}
+
+template <typename T>
+void DoggyEye::render(T *canvas, BoundingRect rect, DrawContext *ctx) {
+  this->update(rect, ctx);
 
   if (this->open_ratio_ == 0) {
     // eye closed
@@ -572,4 +662,20 @@ void DoggyEye::draw(M5Canvas *canvas, BoundingRect rect, DrawContext *ctx) {
   canvas->fillEllipse(iris_x_ - 3, iris_y_ - 3, 3, 3, skin_color_);
 }
 
+void DoggyEye::draw(M5Canvas *canvas, BoundingRect rect, DrawContext *ctx) {
+  if (drawCached(this, &DoggyEye::render<DisplayList>, canvas, rect, ctx)) {
+    return;
+  }
+  render(canvas, rect, ctx);
+}
+
+bool DoggyEye::record(DisplayList *list, BoundingRect rect, DrawContext *ctx) {
+  render(list, rect, ctx);
+  return true;
+}
+
+template void ToonEye1::drawEyelid(M5Canvas *canvas);
+template void ToonEye2::drawEyelid(M5Canvas *canvas);
+template void PinkDemonEye::drawEyelid(M5Canvas *canvas);
+
 }  // namespace m5avatar
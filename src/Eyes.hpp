@@ -16,6 +16,7 @@
 #include <Drawable.h>
 
 #include "DrawingUtils.hpp"
+#include "RasterCache.hpp"
 namespace m5avatar {
 
 // pure drawing functions
@@ -30,7 +31,7 @@ class BaseEye : public Drawable {
   bool is_left_;
 
   // caches for drawing
-  ColorPalette *palette_;
+  const ColorPalette *palette_;
   int16_t center_x_;
   int16_t center_y_;
   Gaze gaze_;
@@ -41,20 +42,68 @@ class BaseEye : public Drawable {
   float open_ratio_;
   Expression expression_;
 
+  RasterCache raster_cache_;
+
+  // key of the raster cache from the state set by update()
+  uint32_t rasterKey() const;
+
+  /**
+   * @brief draw the eye through the raster cache
+   *
+   * @param part eye drawn by this function
+   * @param render function recording the eye into a display list
+   * @return false when the cache is disabled and nothing is drawn
+   */
+  template <typename Part>
+  bool drawCached(Part *part,
+                  void (Part::*render)(DisplayList *, BoundingRect,
+                                       DrawContext *),
+                  M5Canvas *canvas, BoundingRect rect, DrawContext *ctx) {
+    if (!raster_cache_.isEnabled()) {
+      return false;
+    }
+    update(rect, ctx);
+    uint32_t key = rasterKey();
+    if (!raster_cache_.draw(canvas, key, center_x_, center_y_, ctx)) {
+      (part->*render)(raster_cache_.record(), rect, ctx);
+      raster_cache_.store(canvas, key, center_x_, center_y_, ctx);
+    }
+    return true;
+  }
+
  public:
   BaseEye(bool is_left);
   BaseEye(uint16_t width, uint16_t height, bool is_left);
   void update(M5Canvas *canvas, BoundingRect rect, DrawContext *ctx);
+  void update(BoundingRect rect, DrawContext *ctx);
+
+  /**
+   * @brief cache rasterized eyes up to the budget
+   *
+   * The open ratio is quantized into 1/16 steps while the cache is enabled.
+   *
+   * @param bytes max bytes of cached sprites. 0 disables the cache
+   */
+  void setRasterCacheBudget(size_t bytes) { raster_cache_.setBudget(bytes); }
+  const RasterCache *getRasterCache() const { return &raster_cache_; }
 };
 
 class EllipseEye : public BaseEye {
+ protected:
+  template <typename T>
+  void render(T *canvas, BoundingRect rect, DrawContext *ctx);
+
  public:
   using BaseEye::BaseEye;
   void draw(M5Canvas *canvas, BoundingRect rect, DrawContext *ctx);
+  bool record(DisplayList *list, BoundingRect rect, DrawContext *ctx);
 };
 
 class ToonEye1 : public BaseEye {
  protected:
+  template <typename T>
+  void render(T *canvas, BoundingRect rect, DrawContext *ctx);
+
   void computeEyelidBaseWaypoints(float &medial_x, float &medial_y,
                                   float &center_x, float &center_y,
                                   float &lateral_x, float &lateral_y,
@@ -70,15 +119,20 @@ class ToonEye1 : public BaseEye {
   using BaseEye::BaseEye;
 
   void update2(M5Canvas *canvas, BoundingRect rect, DrawContext *ctx);
-  void drawEyelid(M5Canvas *canvas);
+  template <typename T>
+  void drawEyelid(T *canvas);
   void drawEyelash(M5Canvas *canvas);
   void overwriteOpenRatio();
   void draw(M5Canvas *canvas, BoundingRect rect, DrawContext *ctx);
+  bool record(DisplayList *list, BoundingRect rect, DrawContext *ctx);
 };
 
 // sigurenui eye
 class ToonEye2 : public BaseEye {
  protected:
+  template <typename T>
+  void render(T *canvas, BoundingRect rect, DrawContext *ctx);
+
   void computeEyelidBaseWaypoints(float &medial_x, float &medial_y,
                                   float &center_x, float &center_y,
                                   float &lateral_x, float &lateral_y,
@@ -95,24 +149,37 @@ class ToonEye2 : public BaseEye {
 
   void update2(M5Canvas *canvas, BoundingRect rect, DrawContext *ctx);
 
-  void drawEyelid(M5Canvas *canvas);
+  template <typename T>
+  void drawEyelid(T *canvas);
   void drawEyelash(M5Canvas *canvas);
   void overwriteOpenRatio();
   void draw(M5Canvas *canvas, BoundingRect rect, DrawContext *ctx);
+  bool record(DisplayList *list, BoundingRect rect, DrawContext *ctx);
 };
 
 class PinkDemonEye : public BaseEye {
+ protected:
+  template <typename T>
+  void render(T *canvas, BoundingRect rect, DrawContext *ctx);
+
  public:
   using BaseEye::BaseEye;
-  void drawEyelid(M5Canvas *canvas);
+  template <typename T>
+  void drawEyelid(T *canvas);
   void overwriteOpenRatio();
   void draw(M5Canvas *canvas, BoundingRect rect, DrawContext *ctx);
+  bool record(DisplayList *list, BoundingRect rect, DrawContext *ctx);
 };
 
 class DoggyEye : public BaseEye {
+ protected:
+  template <typename T>
+  void render(T *canvas, BoundingRect rect, DrawContext *ctx);
+
  public:
   using BaseEye::BaseEye;
   void draw(M5Canvas *canvas, BoundingRect rect, DrawContext *ctx);
+  bool record(DisplayList *list, BoundingRect rect, DrawContext *ctx);
 };
 }  // namespace m5avatar
 
@@ -4,12 +4,22 @@
 
 #include "Face.h"
 
+#include <algorithm>
+
 #ifndef _min
 #define _min(a, b) std::min(a, b)
 #endif
 
 namespace m5avatar {
-BoundingRect br;
+
+namespace {
+
+constexpr size_t kNumLocations = ColorPalette::kNumLocations;
+
+// wait for a frame buffer freed by the transfer task
+constexpr uint32_t kPipelineTimeout = 100;  // [msec]
+
+}  // namespace
 
 Face::Face()
     : Face(new Mouth(50, 90, 4, 60), new BoundingRect(148, 163),
@@ -31,7 +41,8 @@ Face::Face(Drawable *mouth, BoundingRect *mouthPos, Drawable *eyeR,
     : Face(mouth, mouthPos, eyeR, eyeRPos, eyeL, eyeLPos, eyeblowR,
            eyeblowRPos, eyeblowL, eyeblowLPos,
            new BoundingRect(0, 0, 320, 240),
-           new M5Canvas(&M5.Lcd), new M5Canvas(&M5.Lcd)) {}
+           // not bound to a display. frames are pushed to output
+           new M5Canvas(), new M5Canvas()) {}
 
 Face::Face(Drawable *mouth, BoundingRect *mouthPos, Drawable *eyeR,
        BoundingRect *eyeRPos, Drawable *eyeL, BoundingRect *eyeLPos,
@@ -50,7 +61,41 @@ Face::Face(Drawable *mouth, BoundingRect *mouthPos, Drawable *eyeR,
       eyeblowLPos{eyeblowLPos},
       boundingRect{boundingRect},
       sprite{spr},
-      tmpSprite{tmpSpr} {}
+      tmpSprite{tmpSpr},
+      strips{tmpSpr},
+      stripHeight{8},
+      stripCount{2},
+      stripColorDepth{0},
+      retainSprite{false},
+      incrementalDraw{false},
+      frameDiff{},
+      occupancy{},
+      panelClear{},
+      frameColorDepth{0},
+      lastRotation{0},
+      lastScale{1},
+      lastRect{},
+      lastPrimaryColor{0},
+      lastBackgroundColor{0},
+      displayListEnabled{false},
+      displayList{},
+      lastDisplayList{},
+      lastDisplayListValid{false},
+      stripRendering{false},
+      lastStripRendered{false},
+      indexedColorDepth{0},
+      indexPalette{},
+      indexSlots{},
+      indexColors{},
+      indexed{false},
+      indexColorsChanged{false},
+      framePalette{false},
+      stripPalette{false},
+      pipeline{nullptr},
+#ifdef M5AVATAR_FRAME_STATS
+      stats{nullptr},
+#endif
+      output{&M5.Display} {}
 
 Face::~Face() {
   delete mouth;
@@ -64,10 +109,14 @@ Face::~Face() {
   delete eyeblowL;
   delete eyeblowLPos;
   delete sprite;
+  for (auto strip : strips) {
+    delete strip;
+  }
   delete boundingRect;
   delete b;
   delete h;
   delete battery;
+  delete pipeline;
 }
 
 void Face::setMouth(Drawable *mouth) { this->mouth = mouth; }
@@ -84,91 +133,856 @@ Drawable *Face::getRightEye() { return eyeR; }
 
 BoundingRect *Face::getBoundingRect() { return boundingRect; }
 
-void Face::draw(DrawContext *ctx) {
-  sprite->createSprite(boundingRect->getWidth(), boundingRect->getHeight());
-  sprite->setColorDepth(ctx->getColorDepth());
-  // NOTE: setting below for 1-bit color depth
-  sprite->setBitmapColor(ctx->getColorPalette()->get(COLOR_PRIMARY),
-    ctx->getColorPalette()->get(COLOR_BACKGROUND));
-  if (ctx->getColorDepth() != 1) {
-    sprite->fillSprite(ctx->getColorPalette()->get(COLOR_BACKGROUND));
+void Face::setIncrementalDraw(bool incremental) {
+  if (!incremental) {
+    frameDiff.release();
+  }
+  incrementalDraw = incremental;
+  frameDiff.invalidate();
+}
+
+bool Face::isIncrementalDraw() { return incrementalDraw; }
+
+void Face::invalidate() {
+  frameDiff.invalidate();
+  lastDisplayListValid = false;
+  invalidatePanel();
+}
+
+void Face::invalidatePanel() {
+  if (pipeline != nullptr) {
+    // panelClear belongs to the transfer task
+    pipeline->invalidate();
+    return;
+  }
+  panelClear.assign(panelClear.size(), false);
+}
+
+void Face::setDisplayListEnabled(bool enabled) {
+  if (enabled || stripRendering) {
+    displayList.reserve(DisplayList::kDefaultCapacity,
+                        DisplayList::kDefaultTextCapacity);
+    lastDisplayList.reserve(DisplayList::kDefaultCapacity,
+                            DisplayList::kDefaultTextCapacity);
   } else {
-    sprite->fillSprite(0);
+    displayList.release();
+    lastDisplayList.release();
   }
+  displayListEnabled = enabled;
+  lastDisplayListValid = false;
+}
+
+bool Face::isDisplayListEnabled() { return displayListEnabled; }
+
+void Face::setStripRendering(bool enabled) {
+  stripRendering = enabled;
+  // strip rendering records parts into the display list
+  setDisplayListEnabled(displayListEnabled);
+}
+
+bool Face::isStripRendering() { return stripRendering; }
+
+const DisplayList *Face::getDisplayList() {
+  return lastDisplayListValid ? &lastDisplayList : nullptr;
+}
+
+void Face::setIndexedColorDepth(uint8_t bits) {
+  if (bits != 0 && bits != 2 && bits != 4 && bits != 8) {
+    M5_LOGE("unsupported indexed color depth: %d", bits);
+    return;
+  }
+  indexedColorDepth = bits;
+  indexSlots.clear();
+  indexColors.clear();
+  invalidate();
+}
+
+uint8_t Face::getIndexedColorDepth() { return indexedColorDepth; }
+
+bool Face::updateIndexPalette(ColorPalette *palette) {
+  size_t max_colors = 1u << indexedColorDepth;
+  uint16_t colors[256];
+  int16_t slots[kNumLocations];
+  size_t count = 0;
+  // NOTE: kSkin (background) is the first location, so the background is
+  // index 0
+  for (size_t i = 0; i < kNumLocations; i++) {
+    auto location = static_cast<DrawingLocation>(i);
+    slots[i] = -1;
+    if (!palette->contains(location)) {
+      continue;
+    }
+    uint16_t color = palette->get(location);
+    size_t j = 0;
+    while (j < count && colors[j] != color) {
+      j++;
+    }
+    if (j == count) {
+      if (count == max_colors) {
+        return false;
+      }
+      colors[count++] = color;
+    }
+    slots[i] = j;
+  }
+
+  if (indexSlots.size() != kNumLocations ||
+      !std::equal(slots, slots + kNumLocations, indexSlots.begin())) {
+    // parts draw other indices. FrameDiff or the display list finds them
+    indexSlots.assign(slots, slots + kNumLocations);
+    indexPalette.clear();
+    for (size_t i = 0; i < kNumLocations; i++) {
+      if (slots[i] >= 0) {
+        indexPalette.set(static_cast<DrawingLocation>(i), slots[i]);
+      }
+    }
+  }
+  if (indexColors.size() != count ||
+      !std::equal(colors, colors + count, indexColors.begin())) {
+    // same indices with other colors. the frame is pushed again without
+    // drawing the parts
+    indexColors.assign(colors, colors + count);
+    indexColorsChanged = true;
+    invalidatePanel();
+  }
+  return true;
+}
+
+void Face::applyIndexColors(M5Canvas *canvas) {
+  for (size_t i = 0; i < indexColors.size(); i++) {
+    uint16_t c = indexColors[i];
+    // RGB565 to RGB888
+    uint8_t r = (c >> 11) & 0x1F;
+    uint8_t g = (c >> 5) & 0x3F;
+    uint8_t b = c & 0x1F;
+    canvas->setPaletteColor(i, (r << 3) | (r >> 2), (g << 2) | (g >> 4),
+                            (b << 3) | (b >> 2));
+  }
+}
+
+bool Face::isLayoutChanged(DrawContext *ctx) {
+  ColorPalette *cp = ctx->getColorPalette();
+  uint16_t primary = cp->get(COLOR_PRIMARY);
+  uint16_t background = cp->get(COLOR_BACKGROUND);
+  // NOTE: colors of 1-bit sprite are applied when it is pushed, so they are
+  // not detected by FrameDiff
+  bool changed = ctx->getRotation() != lastRotation ||
+                 ctx->getScale() != lastScale ||
+                 boundingRect->getTop() != lastRect.getTop() ||
+                 boundingRect->getLeft() != lastRect.getLeft() ||
+                 boundingRect->getWidth() != lastRect.getWidth() ||
+                 boundingRect->getHeight() != lastRect.getHeight() ||
+                 primary != lastPrimaryColor ||
+                 background != lastBackgroundColor;
+  lastRotation = ctx->getRotation();
+  lastScale = ctx->getScale();
+  lastRect = *boundingRect;
+  lastPrimaryColor = primary;
+  lastBackgroundColor = background;
+  return changed;
+}
+
+BoundingRect Face::transformRect(BoundingRect region, float rotation,
+                                float scale) {
+  if (rotation == 0.0f && scale == 1.0f) {
+    return region;
+  }
+  // same transform as pushRotateZoom: rotate(degree) and zoom around center
+  float cx = boundingRect->getWidth() / 2.0f;
+  float cy = boundingRect->getHeight() / 2.0f;
+  float rad = rotation * M_PI / 180.0f;
+  float c = cosf(rad) * scale;
+  float s = sinf(rad) * scale;
+  float xs[] = {static_cast<float>(region.getLeft()),
+                static_cast<float>(region.getRight())};
+  float ys[] = {static_cast<float>(region.getTop()),
+                static_cast<float>(region.getBottom())};
+  float min_x = boundingRect->getWidth();
+  float min_y = boundingRect->getHeight();
+  float max_x = 0.0f;
+  float max_y = 0.0f;
+  for (float x : xs) {
+    for (float y : ys) {
+      float tx = c * (x - cx) - s * (y - cy) + cx;
+      float ty = s * (x - cx) + c * (y - cy) + cy;
+      min_x = std::min(min_x, tx);
+      min_y = std::min(min_y, ty);
+      max_x = std::max(max_x, tx);
+      max_y = std::max(max_y, ty);
+    }
+  }
+  // margin for resampling
+  float margin = scale + 1.0f;
+  int16_t left = std::max(0.0f, floorf(min_x - margin));
+  int16_t top = std::max(0.0f, floorf(min_y - margin));
+  int16_t right = std::min(static_cast<float>(boundingRect->getWidth()),
+                           ceilf(max_x + margin));
+  int16_t bottom = std::min(static_cast<float>(boundingRect->getHeight()),
+                            ceilf(max_y + margin));
+  if (right <= left || bottom <= top) {
+    return BoundingRect(0, 0, 0, 0);
+  }
+  return BoundingRect(top, left, right - left, bottom - top);
+}
+
+bool Face::prepareSprite(int colorDepth, bool palette, bool retained) {
+  if (sprite->getBuffer() != nullptr &&
+      sprite->width() == boundingRect->getWidth() &&
+      sprite->height() == boundingRect->getHeight() &&
+      frameColorDepth == colorDepth && framePalette == palette) {
+    return true;
+  }
+  // free the old buffer first so that both are not held at the same time
+  sprite->deleteSprite();
+  // NOTE: set color depth before allocation. setColorDepth() on an allocated
+  // sprite allocates the buffer again
+  sprite->setColorDepth(colorDepth);
+  // retained sprite prefers PSRAM to leave internal RAM for other tasks
+  sprite->setPsram(retained);
+  if (sprite->createSprite(boundingRect->getWidth(),
+                           boundingRect->getHeight()) == nullptr) {
+    if (!retained) {
+      return false;
+    }
+    // no PSRAM on the board. fall back to internal RAM
+    sprite->setPsram(false);
+    if (sprite->createSprite(boundingRect->getWidth(),
+                             boundingRect->getHeight()) == nullptr) {
+      return false;
+    }
+  }
+  if (palette && colorDepth == 8) {
+    // sprites below 8 bits have a palette already
+    sprite->createPalette();
+  }
+  frameColorDepth = colorDepth;
+  framePalette = palette;
+  frameDiff.invalidate();
+  lastDisplayListValid = false;
+  return true;
+}
+
+void Face::setRetainSprite(bool retain) { retainSprite = retain; }
+
+bool Face::isRetainSprite() { return retainSprite; }
+
+void Face::setStripHeight(uint8_t height) {
+  stripHeight = height < 1 ? 1 : height;
+  frameDiff.invalidate();
+  panelClear.clear();
+}
+
+uint8_t Face::getStripHeight() { return stripHeight; }
+
+void Face::setStripCount(uint8_t count) { stripCount = count < 1 ? 1 : count; }
+
+uint8_t Face::getStripCount() { return stripCount; }
+
+void Face::releaseSprite() {
+  sprite->deleteSprite();
+  for (auto strip : strips) {
+    strip->deleteSprite();
+  }
+  if (pipeline != nullptr) {
+    pipeline->releaseSprites();
+  }
+  frameDiff.release();
+  frameColorDepth = 0;
+  framePalette = false;
+  lastDisplayListValid = false;
+}
+
+void Face::fillBackground(DrawContext *ctx, BoundingRect area) {
+  if (!indexed) {
+    // NOTE: setting below for 1-bit color depth
+    sprite->setBitmapColor(ctx->getColorPalette()->get(COLOR_PRIMARY),
+      ctx->getColorPalette()->get(COLOR_BACKGROUND));
+  }
+  uint16_t background = ctx->getColorDepth() != 1
+                            ? ctx->getColorPalette()->get(COLOR_BACKGROUND)
+                            : 0;
+  if (area.getWidth() == sprite->width() &&
+      area.getHeight() == sprite->height()) {
+    sprite->fillSprite(background);
+    occupancy.captureBackground(sprite, frameColorDepth);
+  } else {
+    sprite->fillRect(area.getLeft(), area.getTop(), area.getWidth(),
+                     area.getHeight(), background);
+  }
+}
+
+void Face::drawParts(DrawContext *ctx) {
   float breath = _min(1.0f, ctx->getBreath());
 
   // TODO(meganetaaan): unify drawing process of each parts
   BoundingRect rect = *mouthPos;
   rect.setPosition(rect.getTop() + breath * 3, rect.getLeft());
   // copy context to each draw function
-  mouth->draw(sprite, rect, ctx);
+  {
+    M5AVATAR_TIME_STAGE(stats, FrameStage::kMouth);
+    mouth->draw(sprite, rect, ctx);
+  }
 
   rect = *eyeRPos;
   rect.setPosition(rect.getTop() + breath * 3, rect.getLeft());
-  eyeR->draw(sprite, rect, ctx);
+  {
+    M5AVATAR_TIME_STAGE(stats, FrameStage::kRightEye);
+    eyeR->draw(sprite, rect, ctx);
+  }
 
   rect = *eyeLPos;
   rect.setPosition(rect.getTop() + breath * 3, rect.getLeft());
-  eyeL->draw(sprite, rect, ctx);
+  {
+    M5AVATAR_TIME_STAGE(stats, FrameStage::kLeftEye);
+    eyeL->draw(sprite, rect, ctx);
+  }
 
   rect = *eyeblowRPos;
   rect.setPosition(rect.getTop() + breath * 3, rect.getLeft());
-  eyeblowR->draw(sprite, rect, ctx);
+  {
+    M5AVATAR_TIME_STAGE(stats, FrameStage::kRightEyebrow);
+    eyeblowR->draw(sprite, rect, ctx);
+  }
 
   rect = *eyeblowLPos;
   rect.setPosition(rect.getTop() + breath * 3, rect.getLeft());
-  eyeblowL->draw(sprite, rect, ctx);
+  {
+    M5AVATAR_TIME_STAGE(stats, FrameStage::kLeftEyebrow);
+    eyeblowL->draw(sprite, rect, ctx);
+  }
 
   // TODO(meganetaaan): make balloons and effects selectable
-  b->draw(sprite, br, ctx);
-  h->draw(sprite, br, ctx);
-  battery->draw(sprite, br, ctx);
+  // NOTE: overlays are drawn at their own positions
+  M5AVATAR_TIME_STAGE(stats, FrameStage::kOverlays);
+  BoundingRect overlay(0, 0, 0, 0);
+  b->draw(sprite, overlay, ctx);
+  h->draw(sprite, overlay, ctx);
+  battery->draw(sprite, overlay, ctx);
   // drawAccessory(sprite, position, ctx);
+}
+
+bool Face::recordParts(DrawContext *ctx) {
+  M5AVATAR_TIME_STAGE(stats, FrameStage::kRecord);
+  displayList.clear();
+  float breath = _min(1.0f, ctx->getBreath());
+  // same order as drawParts()
+  Drawable *parts[] = {mouth, eyeR, eyeL, eyeblowR, eyeblowL};
+  BoundingRect *positions[] = {mouthPos, eyeRPos, eyeLPos, eyeblowRPos,
+                               eyeblowLPos};
+  for (int i = 0; i < 5; i++) {
+    BoundingRect rect = *positions[i];
+    rect.setPosition(rect.getTop() + breath * 3, rect.getLeft());
+    if (!parts[i]->record(&displayList, rect, ctx)) {
+      return false;
+    }
+  }
+  BoundingRect overlay(0, 0, 0, 0);
+  if (!b->record(&displayList, overlay, ctx) ||
+      !h->record(&displayList, overlay, ctx) ||
+      !battery->record(&displayList, overlay, ctx)) {
+    return false;
+  }
+  return !displayList.isOverflowed();
+}
+
+void Face::draw(DrawContext *ctx) {
+  bool was_indexed = indexed;
+  indexed = indexedColorDepth != 0 && ctx->getColorDepth() != 1 &&
+            updateIndexPalette(ctx->getColorPalette());
+  if (indexed != was_indexed) {
+    invalidate();
+  }
+  if (!indexed) {
+    drawFrame(ctx);
+    return;
+  }
+  // parts draw indices given by indexPalette
+  DrawContext indexed_ctx(
+      ctx->getExpression(), ctx->getBreath(), &indexPalette,
+      ctx->getRightGaze(), ctx->getRightEyeOpenRatio(), ctx->getLeftGaze(),
+      ctx->getLeftEyeOpenRatio(), ctx->getMouthOpenRatio(),
+      ctx->getspeechText(), ctx->getRotation(), ctx->getScale(),
+      indexedColorDepth, ctx->getBatteryIconStatus(), ctx->getBatteryLevel(),
+      ctx->getSpeechFont());
+  drawFrame(&indexed_ctx);
+  indexColorsChanged = false;
+}
 
+void Face::drawFrame(DrawContext *ctx) {
+  if (pipeline != nullptr) {
+    renderFrame(ctx);
+    return;
+  }
   // TODO(meganetaaan): rethink responsibility for transform function
   float scale = ctx->getScale();
   float rotation = ctx->getRotation();
 
-// ▼▼▼▼ここから▼▼▼▼
-  static constexpr uint8_t y_step = 8;
+  bool changed = isLayoutChanged(ctx);
+  if (changed) {
+    invalidate();
+  }
 
-  if (tmpSprite->getBuffer() == nullptr) {
-    // 出力先と同じcolorDepthを指定することで、DMA転送が可能になる。
-    // Display自体は16bit or 24bitしか指定できないが、細長なので1bitではなくても大丈夫。
-    tmpSprite->setColorDepth(M5.Display.getColorDepth());
+  BoundingRect full(0, 0, boundingRect->getWidth(),
+                    boundingRect->getHeight());
+  bool recorded = (displayListEnabled || stripRendering) && recordParts(ctx);
+  if (stripRendering && recorded && rotation == 0.0f && scale == 1.0f &&
+      !displayList.hasUnboundedCommand()) {
+    BoundingRect region = full;
+    if (incrementalDraw && lastDisplayListValid && !indexColorsChanged) {
+      // the display holds the last frame
+      region = displayList.diff(lastDisplayList);
+    }
+    if (region.getWidth() > 0 && region.getHeight() > 0) {
+      renderStrips(ctx, region);
+    }
+    lastDisplayList.swap(displayList);
+    lastDisplayListValid = true;
+    lastStripRendered = true;
+    return;
+  }
+  if (lastStripRendered) {
+    // the sprite does not hold the last frame
+    lastStripRendered = false;
+    lastDisplayListValid = false;
+    frameDiff.invalidate();
+  }
 
-    // 確保するメモリは高さ8ピクセルの横長の細長い短冊状とする。
-    tmpSprite->createSprite(boundingRect->getWidth(), y_step);
+  // incremental drawing compares with the last frame in the sprite
+  bool retained = retainSprite || incrementalDraw;
+  if (!prepareSprite(ctx->getColorDepth(), indexed, retained)) {
+    M5_LOGE("failed to allocate the frame sprite");
+    return;
+  }
+  if (indexed) {
+    applyIndexColors(sprite);
   }
 
-  // 背景クリア用の色を設定
-  tmpSprite->setBaseColor(ctx->getColorPalette()->get(COLOR_BACKGROUND));
-  int y = 0;
-  do {
-    // 背景色で塗り潰し
-    tmpSprite->clear();
+  // changed region of the sprite
+  BoundingRect dirty = full;
+  if (recorded) {
+    if (incrementalDraw && lastDisplayListValid &&
+        !displayList.hasUnboundedCommand() &&
+        !lastDisplayList.hasUnboundedCommand()) {
+      // the sprite holds the last frame. rasterize only differences
+      dirty = displayList.diff(lastDisplayList);
+    }
+    if (dirty.getWidth() > 0 && dirty.getHeight() > 0) {
+      fillBackground(ctx, dirty);
+      M5AVATAR_TIME_STAGE(stats, FrameStage::kRaster);
+      displayList.render(sprite, dirty);
+    }
+    lastDisplayList.swap(displayList);
+    lastDisplayListValid = retained;
+    // hashes of FrameDiff are not updated
+    frameDiff.invalidate();
+  } else {
+    fillBackground(ctx, full);
+    drawParts(ctx);
+    lastDisplayListValid = false;
+    if (incrementalDraw) {
+      dirty = frameDiff.update(sprite, frameColorDepth, stripHeight);
+    }
+  }
 
-    // 傾きとズームを反映してspriteからtmpSpriteに転写
-    sprite->pushRotateZoom(tmpSprite, boundingRect->getWidth()>>1, (boundingRect->getHeight()>>1) - y, rotation, scale, scale);
+  // region of the face to be transferred (face coordinates)
+  BoundingRect region = full;
+  if (incrementalDraw && !indexColorsChanged) {
+    if (dirty.getWidth() == 0 || dirty.getHeight() == 0) {
+      // nothing changed. keep the sprite for the next frame
+      return;
+    }
+    if (!changed) {
+      region = transformRect(dirty, rotation, scale);
+    }
+    if (region.getWidth() == 0 || region.getHeight() == 0) {
+      return;
+    }
+  }
 
-    // tmpSpriteから画面に転写
-    M5.Display.startWrite();
+  uint16_t background = scanBackground(ctx);
+  pushFrame(sprite, &occupancy, region, rotation, scale, background);
 
-    // 事前にstartWriteしておくことで、pushSprite はDMA転送を開始するとすぐに処理を終えて戻ってくる。
-    tmpSprite->pushSprite(&M5.Display, boundingRect->getLeft(), boundingRect->getTop() + y);
+  if (!retained) {
+    sprite->deleteSprite();
+  }
+}
 
-    // DMA転送中にdelay処理を設けることにより、DMA転送中に他のタスクへCPU処理時間を譲ることができる。
-    lgfx::delay(1);
+uint16_t Face::scanBackground(DrawContext *ctx) {
+  occupancy.scan(sprite, frameColorDepth, stripHeight);
+  uint16_t background = ctx->getColorPalette()->get(COLOR_BACKGROUND);
+  if (indexed) {
+    background = indexColors[background];
+    occupancy.setBackgroundColor(background);
+  }
+  return background;
+}
 
-    // endWriteによってDMA転送の終了を待つ。
-    M5.Display.endWrite();
+void Face::pushFrame(M5Canvas *frame, StripOccupancy *occ,
+                     BoundingRect region, float rotation, float scale,
+                     uint16_t background) {
+  size_t num_strips =
+      (boundingRect->getHeight() + stripHeight - 1) / stripHeight;
+  if (panelClear.size() != num_strips) {
+    panelClear.assign(num_strips, false);
+  }
 
-  } while ((y += y_step) < boundingRect->getHeight());
+  int32_t clip_x, clip_y, clip_w, clip_h;
+  output->getClipRect(&clip_x, &clip_y, &clip_w, &clip_h);
+  if (rotation == 0.0f && scale == 1.0f) {
+    pushRows(frame, occ, region);
+  } else if (prepareStrips(output->getColorDepth(), false)) {
+    pushStrips(frame, occ, region, rotation, scale, background);
+  } else {
+    M5_LOGE("failed to allocate the strip buffers");
+  }
+  output->setClipRect(clip_x, clip_y, clip_w, clip_h);
+}
 
-// 削除するのが良いかどうか要検討 (次回メモリ確保できない場合は描画できなくなるので、維持しておいても良いかも？)
-// tmpSprite->deleteSprite();
-// ▲▲▲▲ここまで▲▲▲▲
+void Face::renderFrame(DrawContext *ctx) {
+  FrameBuffer *frame = pipeline->acquire(kPipelineTimeout);
+  if (frame == nullptr) {
+    M5_LOGE("no frame buffer was freed by the transfer task");
+    return;
+  }
+  if (isLayoutChanged(ctx) || indexColorsChanged) {
+    pipeline->invalidate();
+  }
+  // parts draw into the frame sprite. swap in the buffer of this frame
+  std::swap(sprite, frame->sprite);
+  std::swap(frameColorDepth, frame->colorDepth);
+  std::swap(framePalette, frame->palette);
+  std::swap(occupancy, frame->occupancy);
+  bool rendered = prepareSprite(ctx->getColorDepth(), indexed, true);
+  if (rendered) {
+    if (indexed) {
+      applyIndexColors(sprite);
+    }
+    BoundingRect full(0, 0, boundingRect->getWidth(),
+                      boundingRect->getHeight());
+    fillBackground(ctx, full);
+    if (displayListEnabled && recordParts(ctx)) {
+      M5AVATAR_TIME_STAGE(stats, FrameStage::kRaster);
+      displayList.render(sprite, full);
+    } else {
+      drawParts(ctx);
+    }
+    frame->background = scanBackground(ctx);
+    frame->region = full;
+    frame->rotation = ctx->getRotation();
+    frame->scale = ctx->getScale();
+  } else {
+    M5_LOGE("failed to allocate the frame sprite");
+  }
+  std::swap(sprite, frame->sprite);
+  std::swap(frameColorDepth, frame->colorDepth);
+  std::swap(framePalette, frame->palette);
+  std::swap(occupancy, frame->occupancy);
+  // the other buffer does not hold the last frame
+  lastDisplayListValid = false;
+  if (rendered) {
+    pipeline->submit(frame);
+  } else {
+    pipeline->cancel(frame);
+  }
+}
 
-  sprite->deleteSprite();
+bool Face::presentFrame(uint32_t timeout_ms) {
+  if (pipeline == nullptr) {
+    return false;
+  }
+  FrameBuffer *frame = pipeline->receive(timeout_ms);
+  if (frame == nullptr) {
+    return false;
+  }
+  if (pipeline->takeInvalidated()) {
+    panelClear.assign(panelClear.size(), false);
+  }
+  pushFrame(frame->sprite, &frame->occupancy, frame->region, frame->rotation,
+            frame->scale, frame->background);
+  pipeline->recycle(frame);
+  return true;
+}
+
+void Face::setPipelined(bool enabled, uint8_t depth) {
+  delete pipeline;
+  pipeline = enabled ? new FramePipeline(output, depth) : nullptr;
+  invalidate();
 }
+
+bool Face::isPipelined() { return pipeline != nullptr; }
+
+void Face::setOutput(LovyanGFX *output) {
+  this->output = output;
+  // the panel content of the new output is unknown
+  panelClear.clear();
+  invalidate();
+}
+
+LovyanGFX *Face::getOutput() { return output; }
+
+void Face::setFrameStats(FrameStats *stats) {
+#ifdef M5AVATAR_FRAME_STATS
+  this->stats = stats;
+#endif
+}
+
+bool Face::prepareStrips(int colorDepth, bool palette) {
+  while (strips.size() < stripCount) {
+    strips.push_back(new M5Canvas(output));
+  }
+  while (strips.size() > stripCount) {
+    delete strips.back();
+    strips.pop_back();
+  }
+  if (colorDepth != stripColorDepth || palette != stripPalette) {
+    for (auto strip : strips) {
+      strip->deleteSprite();
+    }
+    stripColorDepth = colorDepth;
+    stripPalette = palette;
+  }
+  for (auto strip : strips) {
+    if (strip->getBuffer() != nullptr &&
+        strip->width() == boundingRect->getWidth() &&
+        strip->height() == stripHeight) {
+      continue;
+    }
+    strip->deleteSprite();
+    // 出力先と同じcolorDepthを指定することで、DMA転送が可能になる。
+    // Display自体は16bit or 24bitしか指定できないが、細長なので1bitではなくても大丈夫。
+    strip->setColorDepth(colorDepth);
+
+    // 確保するメモリは高さstripHeightピクセルの横長の細長い短冊状とする。
+    if (strip->createSprite(boundingRect->getWidth(), stripHeight) ==
+        nullptr) {
+      return false;
+    }
+    if (palette && colorDepth == 8) {
+      strip->createPalette();
+    }
+  }
+  return true;
+}
+
+void Face::renderStrips(DrawContext *ctx, BoundingRect region) {
+  // colors of 1-bit and indexed faces are palette indices. other faces are
+  // rasterized in the color depth of the display so that strips are
+  // transferred by DMA
+  int depth = ctx->getColorDepth() == 1 || indexed
+                  ? ctx->getColorDepth()
+                  : output->getColorDepth();
+  if (!prepareStrips(depth, indexed)) {
+    M5_LOGE("failed to allocate the strip buffers");
+    return;
+  }
+  ColorPalette *cp = ctx->getColorPalette();
+  uint16_t background = cp->get(COLOR_BACKGROUND);
+  uint16_t fill = depth == 1 ? 0 : background;
+  if (indexed) {
+    background = indexColors[fill];
+    for (auto strip : strips) {
+      applyIndexColors(strip);
+    }
+  } else if (depth == 1) {
+    for (auto strip : strips) {
+      strip->setBitmapColor(cp->get(COLOR_PRIMARY), background);
+    }
+  }
+  occupancy.scan(displayList, boundingRect->getHeight(), stripHeight);
+  occupancy.setBackgroundColor(background);
+  size_t num_strips =
+      (boundingRect->getHeight() + stripHeight - 1) / stripHeight;
+  if (panelClear.size() != num_strips) {
+    panelClear.assign(num_strips, false);
+  }
+
+  int32_t clip_x, clip_y, clip_w, clip_h;
+  output->getClipRect(&clip_x, &clip_y, &clip_w, &clip_h);
+  output->startWrite();
+  size_t index = 0;
+  int y = region.getTop() / stripHeight * stripHeight;
+  for (; y < region.getBottom(); y += stripHeight) {
+    if (!occupancy.isOccupied(y, y + stripHeight)) {
+      fillStrip(&occupancy, y, region);
+      continue;
+    }
+    panelClear[y / stripHeight] = false;
+
+    M5Canvas *strip = strips[index];
+    if (strips.size() == 1) {
+      // the only buffer may still be in transfer
+      M5AVATAR_TIME_STAGE(stats, FrameStage::kDmaWait);
+      output->waitDMA();
+    }
+    {
+      M5AVATAR_TIME_STAGE(stats, FrameStage::kRaster);
+      strip->fillSprite(fill);
+      displayList.render(strip, region, y);
+    }
+
+    int top = std::max<int>(y, region.getTop());
+    int bottom = std::min<int>(y + stripHeight, region.getBottom());
+    output->setClipRect(boundingRect->getLeft() + region.getLeft(),
+                        boundingRect->getTop() + top, region.getWidth(),
+                        bottom - top);
+    // NOTE: pushSprite waits for the transfer of the previous strip. see
+    // pushStrips()
+    M5AVATAR_STAGE_BEGIN(transfer_start);
+    strip->pushSprite(output, boundingRect->getLeft(),
+                      boundingRect->getTop() + y);
+    M5AVATAR_STAGE_END(stats, FrameStage::kTransfer, transfer_start);
+    index = (index + 1) % strips.size();
+  }
+  M5AVATAR_STAGE_BEGIN(wait_start);
+  output->endWrite();
+  M5AVATAR_STAGE_END(stats, FrameStage::kDmaWait, wait_start);
+  output->setClipRect(clip_x, clip_y, clip_w, clip_h);
+}
+
+void Face::fillStrip(StripOccupancy *occ, int y, BoundingRect region) {
+  size_t index = y / stripHeight;
+  if (panelClear[index]) {
+    // the display already holds the background here
+    return;
+  }
+  int strip_bottom = std::min<int>(y + stripHeight, boundingRect->getHeight());
+  int top = std::max<int>(y, region.getTop());
+  int bottom = std::min<int>(strip_bottom, region.getBottom());
+  output->setClipRect(boundingRect->getLeft() + region.getLeft(),
+                      boundingRect->getTop() + top, region.getWidth(),
+                      bottom - top);
+  output->fillRect(boundingRect->getLeft() + region.getLeft(),
+                   boundingRect->getTop() + top, region.getWidth(),
+                   bottom - top, occ->getBackgroundColor());
+  panelClear[index] = region.getLeft() == 0 &&
+                      region.getWidth() == boundingRect->getWidth() &&
+                      top == y && bottom == strip_bottom;
+}
+
+void Face::pushRows(M5Canvas *frame, StripOccupancy *occ,
+                    BoundingRect region) {
+  // no transform. the frame sprite is pushed as it is without resampling.
+  // pushSprite uses DMA when the sprite buffer is DMA capable and converts
+  // colors line by line otherwise
+  output->startWrite();
+  int y = region.getTop() / stripHeight * stripHeight;
+  while (y < region.getBottom()) {
+    if (!occ->isOccupied(y, y + stripHeight)) {
+      fillStrip(occ, y, region);
+      y += stripHeight;
+      continue;
+    }
+    // push consecutive occupied strips at once
+    int top = std::max<int>(y, region.getTop());
+    while (y < region.getBottom() &&
+           occ->isOccupied(y, y + stripHeight)) {
+      panelClear[y / stripHeight] = false;
+      y += stripHeight;
+    }
+    int bottom = std::min<int>(y, region.getBottom());
+    output->setClipRect(boundingRect->getLeft() + region.getLeft(),
+                        boundingRect->getTop() + top, region.getWidth(),
+                        bottom - top);
+    M5AVATAR_TIME_STAGE(stats, FrameStage::kTransfer);
+    frame->pushSprite(output, boundingRect->getLeft(),
+                      boundingRect->getTop());
+  }
+  M5AVATAR_STAGE_BEGIN(wait_start);
+  output->endWrite();
+  M5AVATAR_STAGE_END(stats, FrameStage::kDmaWait, wait_start);
+}
+
+bool Face::isSourceOccupied(StripOccupancy *occ, int y, float rotation,
+                            float scale) {
+  if (scale == 0.0f) {
+    return false;
+  }
+  // inverse of the transform in transformRect(). only rows are needed
+  float cx = boundingRect->getWidth() / 2.0f;
+  float cy = boundingRect->getHeight() / 2.0f;
+  float rad = rotation * M_PI / 180.0f;
+  float c = cosf(rad) / scale;
+  float s = sinf(rad) / scale;
+  float xs[] = {0.0f, static_cast<float>(boundingRect->getWidth())};
+  float ys[] = {static_cast<float>(y), static_cast<float>(y + stripHeight)};
+  float min_y = boundingRect->getHeight();
+  float max_y = 0.0f;
+  for (float x : xs) {
+    for (float yy : ys) {
+      float sy = -s * (x - cx) + c * (yy - cy) + cy;
+      min_y = std::min(min_y, sy);
+      max_y = std::max(max_y, sy);
+    }
+  }
+  // margin for resampling
+  return occ->isOccupied(floorf(min_y) - 2, ceilf(max_y) + 2);
+}
+
+void Face::pushStrips(M5Canvas *frame, StripOccupancy *occ,
+                      BoundingRect region, float rotation, float scale,
+                      uint16_t background) {
+  bool clipped = region.getWidth() != boundingRect->getWidth() ||
+                 region.getHeight() != boundingRect->getHeight();
+  for (auto strip : strips) {
+    // 背景クリア用の色を設定
+    strip->setBaseColor(background);
+    if (clipped) {
+      strip->setClipRect(region.getLeft(), 0, region.getWidth(), stripHeight);
+    }
+  }
+
+  // 事前にstartWriteしておくことで、pushSprite はDMA転送を開始するとすぐに処理を終えて戻ってくる。
+  output->startWrite();
+  size_t index = 0;
+  int y = region.getTop() / stripHeight * stripHeight;
+  do {
+    if (!isSourceOccupied(occ, y, rotation, scale)) {
+      // the strip has only the background. no need to resample
+      fillStrip(occ, y, region);
+      continue;
+    }
+    panelClear[y / stripHeight] = false;
+
+    M5Canvas *strip = strips[index];
+    if (strips.size() == 1) {
+      // the only buffer may still be in transfer
+      M5AVATAR_TIME_STAGE(stats, FrameStage::kDmaWait);
+      output->waitDMA();
+    }
+    {
+      M5AVATAR_TIME_STAGE(stats, FrameStage::kResample);
+      // 背景色で塗り潰し
+      strip->clear();
+
+      // 傾きとズームを反映してspriteからstripに転写
+      frame->pushRotateZoom(strip, boundingRect->getWidth() >> 1,
+                            (boundingRect->getHeight() >> 1) - y, rotation,
+                            scale, scale);
+    }
+
+    // stripから画面に転写
+    // NOTE: pushSprite waits for the transfer of the previous strip before
+    // starting DMA. Thus the buffer of the previous strip is free to render
+    // the next strip while this strip is being transferred.
+    output->setClipRect(boundingRect->getLeft() + region.getLeft(),
+                        boundingRect->getTop() + region.getTop(),
+                        region.getWidth(), region.getHeight());
+    M5AVATAR_STAGE_BEGIN(transfer_start);
+    strip->pushSprite(output, boundingRect->getLeft(),
+                      boundingRect->getTop() + y);
+    M5AVATAR_STAGE_END(stats, FrameStage::kTransfer, transfer_start);
+    index = (index + 1) % strips.size();
+  } while ((y += stripHeight) < region.getBottom());
+  // endWriteによってDMA転送の終了を待つ。
+  M5AVATAR_STAGE_BEGIN(wait_start);
+  output->endWrite();
+  M5AVATAR_STAGE_END(stats, FrameStage::kDmaWait, wait_start);
+
+  if (clipped) {
+    for (auto strip : strips) {
+      strip->clearClipRect();
+    }
+  }
+}
+
 }  // namespace m5avatar
\ No newline at end of file
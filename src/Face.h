@@ -5,6 +5,8 @@
 #ifndef FACE_H_
 #define FACE_H_
 
+#include <vector>
+
 #include "Balloon.h"
 #include "BoundingRect.h"
 #include "Eye.h"
@@ -12,6 +14,11 @@
 #include "Mouth.h"
 #include "Effect.h"
 #include "BatteryIcon.h"
+#include "DisplayList.hpp"
+#include "FrameDiff.hpp"
+#include "FramePipeline.hpp"
+#include "FrameStats.hpp"
+#include "StripOccupancy.hpp"
 
 namespace m5avatar {
 
@@ -30,10 +37,93 @@ class Face {
   BoundingRect *boundingRect;
   M5Canvas *sprite;
   M5Canvas *tmpSprite;
+  // strip buffers. the first one is tmpSprite
+  std::vector<M5Canvas *> strips;
+  uint8_t stripHeight;
+  uint8_t stripCount;
+  int stripColorDepth;
   Balloon *b;
   Effect *h;
   BatteryIcon *battery;
 
+  // keep the frame sprite between frames
+  bool retainSprite;
+
+  // incremental drawing
+  bool incrementalDraw;
+  FrameDiff frameDiff;
+
+  // background strips
+  StripOccupancy occupancy;
+  // strips of the display known to hold only the background
+  std::vector<bool> panelClear;
+  int frameColorDepth;
+  float lastRotation;
+  float lastScale;
+  BoundingRect lastRect;
+  uint16_t lastPrimaryColor;
+  uint16_t lastBackgroundColor;
+
+  // display list of parts. lastDisplayList is the one rendered in the sprite
+  bool displayListEnabled;
+  DisplayList displayList;
+  DisplayList lastDisplayList;
+  bool lastDisplayListValid;
+
+  // rasterize the display list into strips without the frame sprite
+  bool stripRendering;
+  // the last frame was rasterized into strips. the sprite is stale
+  bool lastStripRendered;
+
+  // indexed color frame buffer. 0 draws colors directly
+  uint8_t indexedColorDepth;
+  // palette given to parts. each location has the index of its color
+  ColorPalette indexPalette;
+  // index of each location in indexPalette. -1 if not in the palette
+  std::vector<int16_t> indexSlots;
+  // colors of indices, expanded when the frame is pushed
+  std::vector<uint16_t> indexColors;
+  // the current frame is drawn with indices
+  bool indexed;
+  // colors of indices changed since the last frame
+  bool indexColorsChanged;
+  bool framePalette;
+  bool stripPalette;
+
+  // frame buffers shared with the transfer task. nullptr when not pipelined
+  FramePipeline *pipeline;
+
+#ifdef M5AVATAR_FRAME_STATS
+  // timers of the stages. nullptr when not measured
+  FrameStats *stats;
+#endif
+
+  // display to draw the face on
+  LovyanGFX *output;
+
+  bool updateIndexPalette(ColorPalette *palette);
+  void applyIndexColors(M5Canvas *canvas);
+  void drawFrame(DrawContext *ctx);
+  bool prepareSprite(int colorDepth, bool palette, bool retained);
+  bool prepareStrips(int colorDepth, bool palette);
+  void renderFrame(DrawContext *ctx);
+  uint16_t scanBackground(DrawContext *ctx);
+  void pushFrame(M5Canvas *frame, StripOccupancy *occ, BoundingRect region,
+                 float rotation, float scale, uint16_t background);
+  void invalidatePanel();
+  void fillStrip(StripOccupancy *occ, int y, BoundingRect region);
+  void pushRows(M5Canvas *frame, StripOccupancy *occ, BoundingRect region);
+  bool isSourceOccupied(StripOccupancy *occ, int y, float rotation,
+                        float scale);
+  void pushStrips(M5Canvas *frame, StripOccupancy *occ, BoundingRect region,
+                  float rotation, float scale, uint16_t background);
+  bool isLayoutChanged(DrawContext *ctx);
+  BoundingRect transformRect(BoundingRect region, float rotation, float scale);
+  void fillBackground(DrawContext *ctx, BoundingRect area);
+  void drawParts(DrawContext *ctx);
+  bool recordParts(DrawContext *ctx);
+  void renderStrips(DrawContext *ctx, BoundingRect region);
+
  public:
   // constructor
   Face();
@@ -68,6 +158,167 @@ class Face {
   void setLeftEyeblow();
   void setRightEyeblow();
 
+  /**
+   * @brief keep the frame sprite allocated between frames
+   *
+   * The sprite is allocated once (in PSRAM if available) and allocated again
+   * only when the color depth or the bounding rect changes. This avoids
+   * allocating and freeing the frame buffer every frame.
+   *
+   * @param retain true to keep the frame sprite
+   */
+  void setRetainSprite(bool retain);
+  bool isRetainSprite();
+
+  /**
+   * @brief set height of strips transferred to the display at once
+   *
+   * Taller strips need more memory but fewer transactions.
+   *
+   * @param height strip height in pixels (default: 8)
+   */
+  void setStripHeight(uint8_t height);
+  uint8_t getStripHeight();
+
+  /**
+   * @brief set number of strip buffers
+   *
+   * With two or more buffers, the next strip is rendered while the previous
+   * one is transferred by DMA.
+   *
+   * @param count number of strip buffers (default: 2)
+   */
+  void setStripCount(uint8_t count);
+  uint8_t getStripCount();
+
+  /**
+   * @brief free the frame sprite and the strip buffers
+   *
+   * They are allocated again on the next draw. Call this while the face is
+   * not being drawn (e.g. after Avatar::suspend()).
+   */
+  void releaseSprite();
+
+  /**
+   * @brief enable/disable incremental drawing
+   *
+   * When enabled, the frame sprite is kept between frames and only the
+   * regions changed since the last frame are transferred to the display.
+   * The whole face is transferred now and then, in case a change was not
+   * detected (see FrameDiff).
+   *
+   * @param incremental true to enable incremental drawing
+   */
+  void setIncrementalDraw(bool incremental);
+  bool isIncrementalDraw();
+
+  /**
+   * @brief force the next frame to be transferred entirely
+   *
+   * Call this after drawing something else over the face on the display.
+   */
+  void invalidate();
+
+  /**
+   * @brief enable/disable the display list
+   *
+   * When enabled, parts record drawing commands into a display list and the
+   * list is rasterized into the sprite at once. With incremental drawing,
+   * only regions where commands differ from the last frame are rasterized.
+   * Parts which do not support recording are drawn immediately as before.
+   *
+   * @param enabled true to enable the display list
+   */
+  void setDisplayListEnabled(bool enabled);
+  bool isDisplayListEnabled();
+
+  /**
+   * @brief display list of the last frame
+   *
+   * @return const DisplayList* nullptr if the last frame was not recorded
+   */
+  const DisplayList *getDisplayList();
+
+  /**
+   * @brief enable/disable strip rendering
+   *
+   * When enabled, parts are recorded into the display list and rasterized
+   * directly into each strip buffer. The frame sprite is not allocated, so
+   * peak memory is a few strips instead of a full frame. Frames with
+   * rotation or zoom, and frames with parts which cannot be rasterized in
+   * strips (e.g. floodFill), are drawn with the frame sprite as before.
+   * Call releaseSprite() to free a sprite allocated before.
+   *
+   * @param enabled true to enable strip rendering
+   */
+  void setStripRendering(bool enabled);
+  bool isStripRendering();
+
+  /**
+   * @brief draw the face with palette indices
+   *
+   * Parts draw indices of palette colors into a frame sprite of 2, 4 or 8
+   * bits per pixel, and indices are expanded into colors when the frame is
+   * pushed to the display. A 4-bit frame is a quarter of a 16-bit frame.
+   * Changing only colors of the palette does not draw the parts again.
+   * Frames with more colors than indices are drawn directly as before.
+   * 1-bit faces are not affected.
+   *
+   * @param bits bits per index (2, 4 or 8). 0 to disable
+   */
+  void setIndexedColorDepth(uint8_t bits);
+  uint8_t getIndexedColorDepth();
+
+  /**
+   * @brief split drawing into a render stage and a transfer stage
+   *
+   * draw() rasterizes a frame into one of the frame buffers and hands it to
+   * presentFrame(), which resamples and pushes it to the display in another
+   * task. Thus frame N+1 is rasterized while frame N is transferred. Each
+   * buffer is a full frame sprite (in PSRAM if available). Frames are pushed
+   * entirely; incremental drawing and strip rendering are not used. Call
+   * this while the face is not being drawn.
+   *
+   * @param enabled true to enable the pipeline
+   * @param depth number of frame buffers (2 or 3)
+   */
+  void setPipelined(bool enabled, uint8_t depth = 2);
+  bool isPipelined();
+
+  /**
+   * @brief push the next frame rendered by draw() to the display
+   *
+   * Call this from the transfer task when the face is pipelined.
+   *
+   * @param timeout_ms milliseconds to wait for a frame
+   * @return false if no frame was rendered within the timeout
+   */
+  bool presentFrame(uint32_t timeout_ms);
+
+  /**
+   * @brief set the display to draw the face on
+   *
+   * Each face draws only on its output, so that faces of several avatars
+   * are drawn on different displays or on different regions of one
+   * display (see getBoundingRect()). Call this while the face is not being
+   * drawn.
+   *
+   * @param output display. M5.Display by default
+   */
+  void setOutput(LovyanGFX *output);
+  LovyanGFX *getOutput();
+
+  /**
+   * @brief record the time of each stage of the frames
+   *
+   * Stages are timed only in builds with M5AVATAR_FRAME_STATS; otherwise
+   * this does nothing. Avatar sets its own stats (see
+   * Avatar::getFrameStats()).
+   *
+   * @param stats histograms to record into, or nullptr
+   */
+  void setFrameStats(FrameStats *stats);
+
   void draw(DrawContext *ctx);
 };
 }  // namespace m5avatar
@@ -0,0 +1,50 @@
+/**
+ * @file FacialState.hpp
+ * @brief state of the avatar drawn in a frame
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef M5AVATAR_FACIAL_STATE_HPP_
+#define M5AVATAR_FACIAL_STATE_HPP_
+
+#include "ColorPalette.h"
+#include "DrawContext.h"
+#include "Expression.h"
+
+namespace m5avatar {
+
+/**
+ * @brief parameters of Avatar read by the draw task
+ *
+ * The struct is trivially copyable, so that it is shared between tasks
+ * through SeqLock.
+ */
+struct FacialState {
+  Expression expression;
+  float breath;
+
+  // eyes
+  float rightEyeOpenRatio;
+  float rightGazeV;
+  float rightGazeH;
+  float leftEyeOpenRatio;
+  float leftGazeV;
+  float leftGazeH;
+
+  float mouthOpenRatio;
+
+  float rotation;
+  float scale;
+  ColorPalette palette;
+  int colorDepth;
+  BatteryIconStatus batteryIconStatus;
+  int32_t batteryLevel;
+  const lgfx::IFont *speechFont;
+};
+
+}  // namespace m5avatar
+
+#endif  // M5AVATAR_FACIAL_STATE_HPP_
@@ -0,0 +1,93 @@
+#include "FrameDiff.hpp"
+
+namespace m5avatar {
+
+FrameDiff::FrameDiff()
+    : hashes{},
+      columns{0},
+      rows{0},
+      tileHeight{0},
+      valid{false},
+      updateCount{0} {}
+
+void FrameDiff::invalidate() { valid = false; }
+
+void FrameDiff::release() {
+  std::vector<uint64_t>().swap(hashes);
+  columns = 0;
+  rows = 0;
+  valid = false;
+}
+
+BoundingRect FrameDiff::update(M5Canvas *canvas, uint8_t bits,
+                               uint8_t tile_height) {
+  int32_t width = canvas->width();
+  int32_t height = canvas->height();
+  auto buffer = static_cast<const uint8_t *>(canvas->getBuffer());
+  if (buffer == nullptr || bits == 0 || tile_height == 0) {
+    valid = false;
+    return BoundingRect(0, 0, width, height);
+  }
+
+  uint16_t cols = (width + kTileWidth - 1) / kTileWidth;
+  uint16_t rws = (height + tile_height - 1) / tile_height;
+  if (cols != columns || rws != rows || tile_height != tileHeight) {
+    columns = cols;
+    rows = rws;
+    tileHeight = tile_height;
+    hashes.assign(columns * rows, 0);
+    valid = false;
+  }
+  if (++updateCount >= kRefreshInterval) {
+    // a tile may have kept its hash through a change
+    valid = false;
+  }
+  if (!valid) {
+    updateCount = 0;
+  }
+
+  // NOTE: rows of the sprite buffer are packed in bytes
+  uint32_t stride = (width * bits + 7) >> 3;
+  uint32_t tile_bytes = (kTileWidth * bits) >> 3;
+
+  int16_t dirty_left = width;
+  int16_t dirty_top = height;
+  int16_t dirty_right = 0;
+  int16_t dirty_bottom = 0;
+  for (uint16_t row = 0; row < rows; row++) {
+    int32_t y0 = row * tileHeight;
+    int32_t y1 = std::min<int32_t>(height, y0 + tileHeight);
+    for (uint16_t col = 0; col < columns; col++) {
+      uint32_t b0 = col * tile_bytes;
+      uint32_t b1 = std::min(stride, b0 + tile_bytes);
+      // FNV-1a
+      uint64_t hash = 14695981039346656037ull;
+      for (int32_t y = y0; y < y1; y++) {
+        const uint8_t *p = buffer + y * stride;
+        for (uint32_t i = b0; i < b1; i++) {
+          hash = (hash ^ p[i]) * 1099511628211ull;
+        }
+      }
+      uint64_t &last = hashes[row * columns + col];
+      if (valid && last == hash) {
+        continue;
+      }
+      last = hash;
+      int16_t x0 = col * kTileWidth;
+      int16_t x1 = std::min<int32_t>(width, x0 + kTileWidth);
+      dirty_left = std::min(dirty_left, x0);
+      dirty_right = std::max(dirty_right, x1);
+      dirty_top = std::min<int16_t>(dirty_top, y0);
+      dirty_bottom = std::max<int16_t>(dirty_bottom, y1);
+    }
+  }
+  valid = true;
+
+  if (dirty_right <= dirty_left || dirty_bottom <= dirty_top) {
+    return BoundingRect(0, 0, 0, 0);
+  }
+  return BoundingRect(dirty_top, dirty_left, dirty_right - dirty_left,
+                      dirty_bottom - dirty_top);
+}
+
+}  // namespace m5avatar
@@ -0,0 +1,79 @@
+/**
+ * @file FrameDiff.hpp
+ * @brief detect regions of a frame sprite changed since the last frame
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef M5AVATAR_FRAME_DIFF_HPP_
+#define M5AVATAR_FRAME_DIFF_HPP_
+
+#include <M5GFX.h>
+
+#include <vector>
+
+#include "BoundingRect.h"
+
+namespace m5avatar {
+
+/**
+ * @brief tile-based change detector for a frame sprite
+ *
+ * The sprite is divided into tiles (kTileWidth x tile height). Each tile keeps
+ * a 64-bit hash of its pixels, and update() reports the union of tiles whose
+ * hash differs from the previous frame.
+ *
+ * A copy of the last frame would double the memory of the sprite, so tiles
+ * are compared by hashes. A change that keeps the hash is missed, and such a
+ * tile stays stale on the display. The whole sprite is reported every
+ * kRefreshInterval updates to bound that.
+ */
+class FrameDiff {
+ private:
+  std::vector<uint64_t> hashes;
+  uint16_t columns;
+  uint16_t rows;
+  uint8_t tileHeight;
+  bool valid;
+  // updates since the whole sprite was reported
+  uint16_t updateCount;
+
+ public:
+  // tile width in pixels. multiple of 8 so that tiles are byte aligned
+  static constexpr uint8_t kTileWidth = 32;
+
+  // updates between reports of the whole sprite
+  static constexpr uint16_t kRefreshInterval = 600;
+
+  FrameDiff();
+  ~FrameDiff() = default;
+  FrameDiff(const FrameDiff &other) = default;
+  FrameDiff &operator=(const FrameDiff &other) = default;
+
+  /**
+   * @brief forget the last frame. the next update() reports the whole sprite
+   */
+  void invalidate();
+
+  /**
+   * @brief release memory for hashes
+   */
+  void release();
+
+  /**
+   * @brief compare the sprite with the last frame
+   *
+   * @param canvas frame sprite
+   * @param bits color depth of the sprite in bits per pixel
+   * @param tile_height height of tiles in pixels
+   * @return BoundingRect changed region in sprite coordinates. its size is 0
+   * if nothing changed. the whole sprite every kRefreshInterval updates
+   */
+  BoundingRect update(M5Canvas *canvas, uint8_t bits, uint8_t tile_height);
+};
+
+}  // namespace m5avatar
+
+#endif  // M5AVATAR_FRAME_DIFF_HPP_
@@ -0,0 +1,141 @@
+/**
+ * @file FramePipeline.cpp
+ * @brief frame buffers handed from the render task to the transfer task
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "FramePipeline.hpp"
+
+#include <algorithm>
+
+namespace m5avatar {
+
+constexpr uint8_t FramePipeline::kMaxDepth;
+
+FramePipeline::FramePipeline(LovyanGFX *parent, uint8_t depth)
+    : buffers{},
+      states{},
+      sequences{},
+      nextSequence{0},
+      depth{depth < 2 ? static_cast<uint8_t>(2)
+                      : std::min(depth, kMaxDepth)},
+      lock{},
+      renderSignal{},
+      transferSignal{},
+      invalidated{true} {
+  for (uint8_t i = 0; i < kMaxDepth; i++) {
+    buffers[i].sprite = i < this->depth ? new M5Canvas(parent) : nullptr;
+    buffers[i].colorDepth = 0;
+    buffers[i].palette = false;
+    buffers[i].rotation = 0.0f;
+    buffers[i].scale = 1.0f;
+    buffers[i].background = 0;
+    states[i] = State::kFree;
+  }
+}
+
+FramePipeline::~FramePipeline() {
+  for (auto &buffer : buffers) {
+    delete buffer.sprite;
+  }
+}
+
+int FramePipeline::indexOf(FrameBuffer *frame) const {
+  int index = frame - buffers;
+  return index >= 0 && index < depth ? index : -1;
+}
+
+void FramePipeline::setState(FrameBuffer *frame, State state) {
+  int index = indexOf(frame);
+  if (index < 0) {
+    return;
+  }
+  lock.lock();
+  states[index] = state;
+  if (state == State::kReady) {
+    sequences[index] = nextSequence++;
+  }
+  lock.unlock();
+}
+
+FrameBuffer *FramePipeline::acquire(uint32_t timeout_ms) {
+  // bind before checking the state so that no recycle() is missed
+  renderSignal.bind();
+  uint32_t start = lgfx::millis();
+  for (;;) {
+    lock.lock();
+    for (uint8_t i = 0; i < depth; i++) {
+      if (states[i] == State::kFree) {
+        states[i] = State::kRendering;
+        lock.unlock();
+        // the render task may exit before the next acquire()
+        renderSignal.unbind();
+        return &buffers[i];
+      }
+    }
+    lock.unlock();
+    uint32_t elapsed = lgfx::millis() - start;
+    if (elapsed >= timeout_ms) {
+      renderSignal.unbind();
+      return nullptr;
+    }
+    renderSignal.wait(timeout_ms - elapsed);
+  }
+}
+
+void FramePipeline::submit(FrameBuffer *frame) {
+  setState(frame, State::kReady);
+  transferSignal.notify();
+}
+
+void FramePipeline::cancel(FrameBuffer *frame) {
+  setState(frame, State::kFree);
+}
+
+FrameBuffer *FramePipeline::receive(uint32_t timeout_ms) {
+  transferSignal.bind();
+  uint32_t start = lgfx::millis();
+  for (;;) {
+    lock.lock();
+    int oldest = -1;
+    for (uint8_t i = 0; i < depth; i++) {
+      if (states[i] == State::kReady &&
+          (oldest < 0 ||
+           static_cast<int32_t>(sequences[i] - sequences[oldest]) < 0)) {
+        oldest = i;
+      }
+    }
+    if (oldest >= 0) {
+      states[oldest] = State::kPresenting;
+      lock.unlock();
+      // the transfer task may exit before the next receive()
+      transferSignal.unbind();
+      return &buffers[oldest];
+    }
+    lock.unlock();
+    uint32_t elapsed = lgfx::millis() - start;
+    if (elapsed >= timeout_ms) {
+      transferSignal.unbind();
+      return nullptr;
+    }
+    transferSignal.wait(timeout_ms - elapsed);
+  }
+}
+
+void FramePipeline::recycle(FrameBuffer *frame) {
+  setState(frame, State::kFree);
+  renderSignal.notify();
+}
+
+void FramePipeline::releaseSprites() {
+  for (uint8_t i = 0; i < depth; i++) {
+    buffers[i].sprite->deleteSprite();
+    buffers[i].colorDepth = 0;
+    buffers[i].palette = false;
+  }
+}
+
+}  // namespace m5avatar
@@ -0,0 +1,116 @@
+/**
+ * @file FramePipeline.hpp
+ * @brief frame buffers handed from the render task to the transfer task
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef M5AVATAR_FRAME_PIPELINE_HPP_
+#define M5AVATAR_FRAME_PIPELINE_HPP_
+
+#include <M5GFX.h>
+
+#include <atomic>
+
+#include "BoundingRect.h"
+#include "SpinLock.hpp"
+#include "StripOccupancy.hpp"
+#include "TaskSignal.hpp"
+
+namespace m5avatar {
+
+/**
+ * @brief rasterized frame and how to push it to the display
+ */
+struct FrameBuffer {
+  M5Canvas *sprite;
+  int colorDepth;
+  bool palette;
+  StripOccupancy occupancy;
+  // region of the face to push
+  BoundingRect region;
+  float rotation;
+  float scale;
+  uint16_t background;
+};
+
+/**
+ * @brief bounded handoff of frame buffers between two tasks
+ *
+ * The render task acquires a free buffer, rasterizes a frame into it and
+ * submits it. The transfer task receives submitted buffers in order, pushes
+ * them to the display and recycles them. With two buffers, frame N+1 is
+ * rasterized while frame N is pushed. The render task waits when all
+ * buffers are in use.
+ *
+ * Only one task renders and one task transfers.
+ */
+class FramePipeline {
+ public:
+  static constexpr uint8_t kMaxDepth = 3;
+
+ private:
+  enum class State : uint8_t { kFree, kRendering, kReady, kPresenting };
+  FrameBuffer buffers[kMaxDepth];
+  State states[kMaxDepth];
+  // order of submitted buffers
+  uint32_t sequences[kMaxDepth];
+  uint32_t nextSequence;
+  uint8_t depth;
+  SpinLock lock;
+  TaskSignal renderSignal;
+  TaskSignal transferSignal;
+  // the display content is unknown, e.g. the face moved
+  std::atomic<bool> invalidated;
+
+  int indexOf(FrameBuffer *frame) const;
+  void setState(FrameBuffer *frame, State state);
+
+ public:
+  /**
+   * @param parent display the frames are pushed to
+   * @param depth number of frame buffers (2 or 3)
+   */
+  explicit FramePipeline(LovyanGFX *parent, uint8_t depth = 2);
+  ~FramePipeline();
+  FramePipeline(const FramePipeline &other) = delete;
+  FramePipeline &operator=(const FramePipeline &other) = delete;
+
+  uint8_t getDepth() const { return depth; }
+
+  /**
+   * @brief take a free buffer to render a frame (render task)
+   *
+   * @return nullptr if no buffer is freed within the timeout
+   */
+  FrameBuffer *acquire(uint32_t timeout_ms);
+  // hand the rendered frame to the transfer task
+  void submit(FrameBuffer *frame);
+  // return an acquired buffer without a frame
+  void cancel(FrameBuffer *frame);
+
+  /**
+   * @brief take the oldest submitted frame (transfer task)
+   *
+   * @return nullptr if no frame is submitted within the timeout
+   */
+  FrameBuffer *receive(uint32_t timeout_ms);
+  // return a pushed buffer to the render task
+  void recycle(FrameBuffer *frame);
+
+  void invalidate() { invalidated.store(true); }
+  bool takeInvalidated() { return invalidated.exchange(false); }
+
+  /**
+   * @brief free the sprites of the buffers
+   *
+   * Call this while neither task uses the pipeline.
+   */
+  void releaseSprites();
+};
+
+}  // namespace m5avatar
+
+#endif  // M5AVATAR_FRAME_PIPELINE_HPP_
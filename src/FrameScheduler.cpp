@@ -0,0 +1,149 @@
+/**
+ * @file FrameScheduler.cpp
+ * @brief pacing of frames of the draw task
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "FrameScheduler.hpp"
+
+#include <algorithm>
+
+#include "TraceRecorder.hpp"
+
+namespace m5avatar {
+
+namespace {
+
+// consecutive missed frames to lower the frame rate
+constexpr uint16_t kMissesToSlowDown = 8;
+// consecutive frames using less than half of the period to raise it
+constexpr uint16_t kSlacksToSpeedUp = 120;
+
+#ifdef SDL_h_
+uint32_t now() { return lgfx::millis(); }
+
+void sleepFor(uint32_t ms) {
+  M5AVATAR_TRACE_SCOPE("sleep", "lgfx::delay");
+  lgfx::delay(ms);
+}
+
+void sleepUntil(uint32_t last_deadline, uint32_t period) {
+  int32_t remaining = static_cast<int32_t>(last_deadline + period - now());
+  if (remaining > 0) {
+    M5AVATAR_TRACE_SCOPE("sleep", "lgfx::delay");
+    lgfx::delay(remaining);
+  }
+}
+#else
+uint32_t now() { return xTaskGetTickCount() * portTICK_PERIOD_MS; }
+
+void sleepFor(uint32_t ms) { vTaskDelay(pdMS_TO_TICKS(ms)); }
+
+void sleepUntil(uint32_t last_deadline, uint32_t period) {
+  TickType_t wake = pdMS_TO_TICKS(last_deadline);
+  vTaskDelayUntil(&wake, pdMS_TO_TICKS(period));
+}
+#endif
+
+}  // namespace
+
+constexpr uint32_t FrameScheduler::kUnpacedDelay;
+
+FrameScheduler::FrameScheduler()
+    : targetFps{0},
+      minFps{10},
+      adaptive{false},
+      currentFps{0},
+      lastDeadline{0},
+      started{false},
+      frameCount{0},
+      missedDeadlines{0},
+      skippedFrames{0},
+      lastFrameTime{0},
+      missStreak{0},
+      slackStreak{0} {}
+
+void FrameScheduler::setTargetFps(uint32_t fps) {
+  targetFps = fps;
+  currentFps = fps;
+  missStreak = 0;
+  slackStreak = 0;
+  started = false;
+}
+
+void FrameScheduler::setAdaptive(bool enabled, uint32_t min_fps) {
+  adaptive = enabled;
+  minFps = min_fps < 1 ? 1 : min_fps;
+  currentFps = targetFps;
+  missStreak = 0;
+  slackStreak = 0;
+}
+
+void FrameScheduler::begin() {
+  lastDeadline = now();
+  started = true;
+}
+
+uint32_t FrameScheduler::getPeriod() const {
+  return currentFps == 0 ? 0 : (1000 + currentFps / 2) / currentFps;
+}
+
+void FrameScheduler::wait() {
+  frameCount++;
+  uint32_t period = getPeriod();
+  if (period == 0) {
+    sleepFor(kUnpacedDelay);
+    return;
+  }
+  if (!started) {
+    begin();
+  }
+
+  uint32_t t = now();
+  lastFrameTime = t - lastDeadline;
+  bool missed = lastFrameTime > period;
+  if (missed) {
+    missedDeadlines++;
+    // skip periods already passed and keep the phase of deadlines
+    uint32_t skips = lastFrameTime / period;
+    skippedFrames += skips - 1;
+    lastDeadline += (skips - 1) * period;
+  }
+  if (adaptive) {
+    adapt(missed, lastFrameTime);
+    period = getPeriod();
+  }
+  sleepUntil(lastDeadline, period);
+  lastDeadline += period;
+}
+
+void FrameScheduler::adapt(bool missed, uint32_t frame_time) {
+  if (missed) {
+    slackStreak = 0;
+    if (++missStreak >= kMissesToSlowDown && currentFps > minFps) {
+      currentFps = std::max(minFps, currentFps * 3 / 4);
+      missStreak = 0;
+    }
+    return;
+  }
+  missStreak = 0;
+  if (frame_time * 2 < getPeriod()) {
+    if (++slackStreak >= kSlacksToSpeedUp && currentFps < targetFps) {
+      currentFps = std::min(targetFps, currentFps + currentFps / 4 + 1);
+      slackStreak = 0;
+    }
+  } else {
+    slackStreak = 0;
+  }
+}
+
+void FrameScheduler::resetStats() {
+  frameCount = 0;
+  missedDeadlines = 0;
+  skippedFrames = 0;
+}
+
+}  // namespace m5avatar
@@ -0,0 +1,102 @@
+/**
+ * @file FrameScheduler.hpp
+ * @brief pacing of frames of the draw task
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef M5AVATAR_FRAME_SCHEDULER_HPP_
+#define M5AVATAR_FRAME_SCHEDULER_HPP_
+
+#include <M5Unified.h>
+
+namespace m5avatar {
+
+/**
+ * @brief frame pacer with absolute deadlines
+ *
+ * wait() sleeps until the deadline of the next frame, which is one period
+ * after the deadline of the last frame (vTaskDelayUntil on FreeRTOS), so the
+ * frame rate does not drift with the time spent for drawing. When a frame
+ * ends after its deadline, the deadline is missed. Periods which have already
+ * passed are skipped instead of being drawn in a burst.
+ *
+ * With the adaptive mode, the frame rate is lowered while deadlines are
+ * missed repeatedly and raised back to the target while frames are drawn in
+ * time.
+ */
+class FrameScheduler {
+ private:
+  uint32_t targetFps;
+  uint32_t minFps;
+  bool adaptive;
+  // frame rate in use. lower than targetFps while adapted
+  uint32_t currentFps;
+
+  // deadline of the last frame in milliseconds
+  uint32_t lastDeadline;
+  bool started;
+
+  uint32_t frameCount;
+  uint32_t missedDeadlines;
+  uint32_t skippedFrames;
+  // time from the deadline of the last frame to the call of wait()
+  uint32_t lastFrameTime;
+  // consecutive frames missed or drawn in time, for the adaptive mode
+  uint16_t missStreak;
+  uint16_t slackStreak;
+
+  uint32_t getPeriod() const;
+  void adapt(bool missed, uint32_t frame_time);
+
+ public:
+  // frames drawn without pacing wait this long (same as before the scheduler)
+  static constexpr uint32_t kUnpacedDelay = 10;
+
+  FrameScheduler();
+  ~FrameScheduler() = default;
+  FrameScheduler(const FrameScheduler &other) = default;
+  FrameScheduler &operator=(const FrameScheduler &other) = default;
+
+  /**
+   * @brief set the target frame rate
+   *
+   * @param fps frames per second. 0 draws frames without pacing
+   */
+  void setTargetFps(uint32_t fps);
+  uint32_t getTargetFps() const { return targetFps; }
+
+  /**
+   * @brief lower the frame rate while deadlines are missed
+   *
+   * @param enabled true to adapt the frame rate
+   * @param min_fps the lowest frame rate in the adaptive mode
+   */
+  void setAdaptive(bool enabled, uint32_t min_fps = 10);
+  bool isAdaptive() const { return adaptive; }
+  uint32_t getCurrentFps() const { return currentFps; }
+
+  /**
+   * @brief start pacing from now
+   */
+  void begin();
+
+  /**
+   * @brief wait for the deadline of the next frame
+   *
+   * Call this after drawing each frame.
+   */
+  void wait();
+
+  uint32_t getFrameCount() const { return frameCount; }
+  uint32_t getMissedDeadlines() const { return missedDeadlines; }
+  uint32_t getSkippedFrames() const { return skippedFrames; }
+  uint32_t getLastFrameTime() const { return lastFrameTime; }
+  void resetStats();
+};
+
+}  // namespace m5avatar
+
+#endif  // M5AVATAR_FRAME_SCHEDULER_HPP_
@@ -0,0 +1,157 @@
+/**
+ * @file FrameStats.cpp
+ * @brief histograms of the time spent in each stage of a frame
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "FrameStats.hpp"
+
+#include <cstdio>
+#include <cstring>
+
+#ifdef SDL_h_
+#include <chrono>
+#elif !defined(ARDUINO)
+#include <esp_cpu.h>
+#include <esp_private/esp_clk.h>
+#endif
+
+namespace m5avatar {
+
+constexpr size_t StageHistogram::kBuckets;
+constexpr size_t FrameStats::kStageCount;
+
+namespace {
+
+const char *const kStageNames[] = {
+    "frame",     "context",  "mouth",    "right_eye", "left_eye",
+    "right_brow", "left_brow", "overlays", "record",    "raster",
+    "resample",  "transfer", "dma_wait",
+};
+
+size_t bucketOf(uint32_t usec) {
+  size_t bucket = 0;
+  while (usec != 0 && bucket < StageHistogram::kBuckets - 1) {
+    usec >>= 1;
+    bucket++;
+  }
+  return bucket;
+}
+
+}  // namespace
+
+uint32_t StageHistogram::getMean() const {
+  return count == 0 ? 0 : total / count;
+}
+
+uint32_t StageHistogram::getPercentile(float percentile) const {
+  if (count == 0) {
+    return 0;
+  }
+  uint32_t rank = static_cast<uint32_t>(count * percentile / 100.0f);
+  if (rank >= count) {
+    rank = count - 1;
+  }
+  uint32_t seen = 0;
+  for (size_t i = 0; i < kBuckets - 1; i++) {
+    seen += buckets[i];
+    if (seen > rank) {
+      uint32_t upper = i == 0 ? 1 : 1u << i;
+      return upper < max ? upper : max;
+    }
+  }
+  return max;
+}
+
+FrameStats::FrameStats() : histograms{}, lock{} {}
+
+bool FrameStats::isEnabled() {
+#ifdef M5AVATAR_FRAME_STATS
+  return true;
+#else
+  return false;
+#endif
+}
+
+const char *FrameStats::getStageName(FrameStage stage) {
+  size_t index = static_cast<size_t>(stage);
+  return index < kStageCount ? kStageNames[index] : "unknown";
+}
+
+void FrameStats::record(FrameStage stage, uint32_t usec) {
+  size_t index = static_cast<size_t>(stage);
+  if (index >= kStageCount) {
+    return;
+  }
+  size_t bucket = bucketOf(usec);
+  lock.lock();
+  StageHistogram &histogram = histograms[index];
+  histogram.count++;
+  histogram.total += usec;
+  if (usec > histogram.max) {
+    histogram.max = usec;
+  }
+  histogram.buckets[bucket]++;
+  lock.unlock();
+}
+
+StageHistogram FrameStats::getHistogram(FrameStage stage) const {
+  StageHistogram histogram{};
+  size_t index = static_cast<size_t>(stage);
+  if (index < kStageCount) {
+    lock.lock();
+    histogram = histograms[index];
+    lock.unlock();
+  }
+  return histogram;
+}
+
+void FrameStats::reset() {
+  lock.lock();
+  memset(histograms, 0, sizeof(histograms));
+  lock.unlock();
+}
+
+void FrameStats::dump() const {
+  printf("%-10s %8s %8s %8s %8s %8s %8s\n", "stage[us]", "count", "mean",
+         "p50", "p90", "p99", "max");
+  for (size_t i = 0; i < kStageCount; i++) {
+    StageHistogram h = getHistogram(static_cast<FrameStage>(i));
+    if (h.count == 0) {
+      continue;
+    }
+    printf("%-10s %8u %8u %8u %8u %8u %8u\n", kStageNames[i],
+           static_cast<unsigned>(h.count), static_cast<unsigned>(h.getMean()),
+           static_cast<unsigned>(h.getPercentile(50.0f)),
+           static_cast<unsigned>(h.getPercentile(90.0f)),
+           static_cast<unsigned>(h.getPercentile(99.0f)),
+           static_cast<unsigned>(h.max));
+  }
+}
+
+uint32_t readCycleCount() {
+#ifdef SDL_h_
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+#elif defined(ARDUINO)
+  return ESP.getCycleCount();
+#else
+  return esp_cpu_get_cycle_count();
+#endif
+}
+
+uint32_t cyclesToMicros(uint32_t cycles) {
+#ifdef SDL_h_
+  return cycles / 1000;
+#elif defined(ARDUINO)
+  return cycles / getCpuFrequencyMhz();
+#else
+  return cycles / (esp_clk_cpu_freq() / 1000000);
+#endif
+}
+
+}  // namespace m5avatar
@@ -0,0 +1,184 @@
+/**
+ * @file FrameStats.hpp
+ * @brief histograms of the time spent in each stage of a frame
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef M5AVATAR_FRAME_STATS_HPP_
+#define M5AVATAR_FRAME_STATS_HPP_
+
+#include <M5Unified.h>
+
+#include "SpinLock.hpp"
+#include "TraceRecorder.hpp"
+
+namespace m5avatar {
+
+/**
+ * @brief stages of a frame
+ */
+enum class FrameStage : uint8_t {
+  kFrame = 0,  // whole Avatar::draw()
+  kContext,    // snapshot of the state and the DrawContext
+  kMouth,      // Drawable::draw() of each part
+  kRightEye,
+  kLeftEye,
+  kRightEyebrow,
+  kLeftEyebrow,
+  kOverlays,  // balloon, effect and battery icon
+  kRecord,    // recording parts into the display list
+  kRaster,    // rasterizing the display list
+  kResample,  // pushRotateZoom() of a strip
+  kTransfer,  // pushSprite() of a strip or rows
+  kDmaWait,   // waiting for DMA transfers
+  kCount,
+};
+
+/**
+ * @brief fixed-size histogram of durations in microseconds
+ *
+ * Bucket 0 counts durations under 1 us and bucket i counts durations in
+ * [2^(i-1), 2^i) us. The last bucket counts everything longer.
+ */
+struct StageHistogram {
+  static constexpr size_t kBuckets = 16;
+  uint32_t count;
+  uint64_t total;  // [usec]
+  uint32_t max;    // [usec]
+  uint32_t buckets[kBuckets];
+
+  uint32_t getMean() const;
+
+  /**
+   * @brief upper bound of the bucket holding the percentile
+   *
+   * @param percentile 0 to 100
+   * @return uint32_t microseconds, or max for the last bucket
+   */
+  uint32_t getPercentile(float percentile) const;
+};
+
+/**
+ * @brief time spent in each stage of the frames of an avatar
+ *
+ * Stages are timed only when the library is built with M5AVATAR_FRAME_STATS
+ * defined (e.g. build_flags = -DM5AVATAR_FRAME_STATS). Otherwise the timers
+ * are compiled out and all histograms stay empty.
+ *
+ * In native builds with M5AVATAR_TRACE, stages are also recorded as trace
+ * events.
+ *
+ * Stages are timed with the cycle counter of the CPU. A task must stay on
+ * one core while a stage is timed, which holds for the pinned tasks of an
+ * avatar.
+ */
+class FrameStats {
+ private:
+  static constexpr size_t kStageCount =
+      static_cast<size_t>(FrameStage::kCount);
+  StageHistogram histograms[kStageCount];
+  // stages are recorded by the draw task and the transfer task
+  mutable SpinLock lock;
+
+ public:
+  FrameStats();
+  ~FrameStats() = default;
+  FrameStats(const FrameStats &other) = delete;
+  FrameStats &operator=(const FrameStats &other) = delete;
+
+  // stages are timed in this build
+  static bool isEnabled();
+  static const char *getStageName(FrameStage stage);
+
+  void record(FrameStage stage, uint32_t usec);
+  StageHistogram getHistogram(FrameStage stage) const;
+  void reset();
+
+  // print count, mean, percentiles and max of each stage
+  void dump() const;
+};
+
+/**
+ * @brief free-running counter for stage timers
+ *
+ * CPU cycles on ESP32 and nanoseconds on SDL. It wraps around; only
+ * differences are meaningful.
+ */
+uint32_t readCycleCount();
+uint32_t cyclesToMicros(uint32_t cycles);
+
+#ifdef M5AVATAR_FRAME_STATS
+/**
+ * @brief records the time until the end of the scope as a stage
+ */
+class StageTimer {
+ private:
+  FrameStats *stats;
+  FrameStage stage;
+  uint32_t start;
+
+ public:
+  StageTimer(FrameStats *stats, FrameStage stage)
+      : stats{stats}, stage{stage}, start{readCycleCount()} {}
+  ~StageTimer() {
+    if (stats != nullptr) {
+      stats->record(stage, cyclesToMicros(readCycleCount() - start));
+    }
+  }
+  StageTimer(const StageTimer &other) = delete;
+  StageTimer &operator=(const StageTimer &other) = delete;
+};
+
+#define M5AVATAR_STAGE_CONCAT_(a, b) a##b
+#define M5AVATAR_STAGE_CONCAT(a, b) M5AVATAR_STAGE_CONCAT_(a, b)
+#define M5AVATAR_STAGE_TIMER_(stats, stage)                             \
+  ::m5avatar::StageTimer M5AVATAR_STAGE_CONCAT(stage_timer_, __LINE__)( \
+      stats, stage)
+#define M5AVATAR_STAGE_BEGIN_(start) \
+  uint32_t start = ::m5avatar::readCycleCount()
+#define M5AVATAR_STAGE_END_(stats, stage, start)                         \
+  do {                                                                   \
+    if ((stats) != nullptr) {                                            \
+      uint32_t stage_cycles_ = ::m5avatar::readCycleCount() - (start);   \
+      (stats)->record(stage, ::m5avatar::cyclesToMicros(stage_cycles_)); \
+    }                                                                    \
+  } while (0)
+#else
+#define M5AVATAR_STAGE_TIMER_(stats, stage)
+#define M5AVATAR_STAGE_BEGIN_(start)
+#define M5AVATAR_STAGE_END_(stats, stage, start)
+#endif
+
+// stages are also trace events. see TraceRecorder
+#ifdef M5AVATAR_TRACE_ENABLED
+#define M5AVATAR_STAGE_TRACE_(stage) \
+  M5AVATAR_TRACE_SCOPE("stage", ::m5avatar::FrameStats::getStageName(stage))
+#define M5AVATAR_STAGE_TRACE_BEGIN_(start) \
+  uint64_t start##_trace = ::m5avatar::TraceRecorder::now()
+#define M5AVATAR_STAGE_TRACE_END_(stage, start) \
+  ::m5avatar::TraceRecorder::complete(          \
+      "stage", ::m5avatar::FrameStats::getStageName(stage), start##_trace)
+#else
+#define M5AVATAR_STAGE_TRACE_(stage)
+#define M5AVATAR_STAGE_TRACE_BEGIN_(start)
+#define M5AVATAR_STAGE_TRACE_END_(stage, start)
+#endif
+
+// times the rest of the enclosing scope as the stage
+#define M5AVATAR_TIME_STAGE(stats, stage) \
+  M5AVATAR_STAGE_TIMER_(stats, stage);    \
+  M5AVATAR_STAGE_TRACE_(stage)
+// times a stage which does not end with a scope
+#define M5AVATAR_STAGE_BEGIN(start) \
+  M5AVATAR_STAGE_BEGIN_(start);     \
+  M5AVATAR_STAGE_TRACE_BEGIN_(start)
+#define M5AVATAR_STAGE_END(stats, stage, start) \
+  M5AVATAR_STAGE_END_(stats, stage, start);     \
+  M5AVATAR_STAGE_TRACE_END_(stage, start)
+
+}  // namespace m5avatar
+
+#endif  // M5AVATAR_FRAME_STATS_HPP_
@@ -17,8 +17,9 @@ Mouth::Mouth(uint16_t minWidth, uint16_t maxWidth, uint16_t minHeight,
       minHeight{minHeight},
       maxHeight{maxHeight} {}
 
-void Mouth::draw(M5Canvas *spi, BoundingRect rect, DrawContext *ctx) {
-  uint16_t primaryColor = ctx->getColorDepth() == 1 ? 1 : ctx->getColorPalette()->get(COLOR_PRIMARY);
+template <typename T>
+void Mouth::render(T *spi, BoundingRect rect, DrawContext *ctx) {
+  uint16_t primaryColor = ctx->getResolvedPalette()->get(COLOR_PRIMARY);
   float breath = _min(1.0f, ctx->getBreath());
   float openRatio = ctx->getMouthOpenRatio();
   int h = minHeight + (maxHeight - minHeight) * openRatio;
@@ -28,4 +29,13 @@ void Mouth::draw(M5Canvas *spi, BoundingRect rect, DrawContext *ctx) {
   spi->fillRect(x, y, w, h, primaryColor);
 }
 
+void Mouth::draw(M5Canvas *spi, BoundingRect rect, DrawContext *ctx) {
+  render(spi, rect, ctx);
+}
+
+bool Mouth::record(DisplayList *list, BoundingRect rect, DrawContext *ctx) {
+  render(list, rect, ctx);
+  return true;
+}
+
 }  // namespace m5avatar
@@ -17,6 +17,8 @@ class Mouth final : public Drawable {
   uint16_t maxWidth;
   uint16_t minHeight;
   uint16_t maxHeight;
+  template <typename T>
+  void render(T *spi, BoundingRect rect, DrawContext *drawContext);
 
  public:
   // constructor
@@ -28,6 +30,8 @@ class Mouth final : public Drawable {
         uint16_t maxHeight);
   void draw(M5Canvas *spi, BoundingRect rect,
             DrawContext *drawContext) override;
+  bool record(DisplayList *list, BoundingRect rect,
+              DrawContext *drawContext) override;
 };
 
 }  // namespace m5avatar
@@ -14,13 +14,13 @@ BaseMouth::BaseMouth(uint16_t min_width, uint16_t max_width,
       max_height_{max_height} {}
 
 void BaseMouth::update(M5Canvas *canvas, BoundingRect rect, DrawContext *ctx) {
-  palette_ = ctx->getColorPalette();
-  background_color_ = ctx->getColorDepth() == 1
-                          ? 1
-                          : palette_->get(DrawingLocation::kMouthBackground);
-  skin_color_ = ctx->getColorDepth() == 1
-                    ? ERACER_COLOR
-                    : palette_->get(DrawingLocation::kSkin);
+  update(rect, ctx);
+}
+
+void BaseMouth::update(BoundingRect rect, DrawContext *ctx) {
+  palette_ = ctx->getResolvedPalette();
+  background_color_ = palette_->get(DrawingLocation::kMouthBackground);
+  skin_color_ = palette_->get(DrawingLocation::kSkin);
   center_x_ = rect.getCenterX();
   center_y_ = rect.getCenterY();
   open_ratio_ = ctx->getMouthOpenRatio();
@@ -28,8 +28,9 @@ void BaseMouth::update(M5Canvas *canvas, BoundingRect rect, DrawContext *ctx) {
   expression_ = ctx->getExpression();
 }
 
-void RectMouth::draw(M5Canvas *canvas, BoundingRect rect, DrawContext *ctx) {
-  this->update(canvas, rect, ctx);  // update drawing cache
+template <typename T>
+void RectMouth::render(T *canvas, BoundingRect rect, DrawContext *ctx) {
+  this->update(rect, ctx);  // update drawing cache
   int16_t h = min_height_ + (max_height_ - min_height_) * open_ratio_;
   int16_t w = min_width_ + (max_width_ - min_width_) * (1 - open_ratio_);
   int16_t top_left_x = rect.getLeft() - w / 2;
@@ -37,9 +38,19 @@ void RectMouth::draw(M5Canvas *canvas, BoundingRect rect, DrawContext *ctx) {
   canvas->fillRect(top_left_x, top_left_y, w, h, background_color_);
 }
 
-void OmegaMouth::draw(M5Canvas *canvas, BoundingRect rect, DrawContext *ctx) {
+void RectMouth::draw(M5Canvas *canvas, BoundingRect rect, DrawContext *ctx) {
+  render(canvas, rect, ctx);
+}
+
+bool RectMouth::record(DisplayList *list, BoundingRect rect, DrawContext *ctx) {
+  render(list, rect, ctx);
+  return true;
+}
+
+template <typename T>
+void OmegaMouth::render(T *canvas, BoundingRect rect, DrawContext *ctx) {
   uint8_t outline_thickness = 2;
-  this->update(canvas, rect, ctx);  // update drawing cache
+  this->update(rect, ctx);  // update drawing cache
   auto h = static_cast<int16_t>(max_height_ * open_ratio_);
 
   if (open_ratio_ > 0.01f) {
@@ -82,8 +93,19 @@ void OmegaMouth::draw(M5Canvas *canvas, BoundingRect rect, DrawContext *ctx) {
   }
 }
 
-void ToonMouth1::draw(M5Canvas *canvas, BoundingRect rect, DrawContext *ctx) {
-  this->update(canvas, rect, ctx);  // update drawing cache
+void OmegaMouth::draw(M5Canvas *canvas, BoundingRect rect, DrawContext *ctx) {
+  render(canvas, rect, ctx);
+}
+
+bool OmegaMouth::record(DisplayList *list, BoundingRect rect,
+                        DrawContext *ctx) {
+  render(list, rect, ctx);
+  return true;
+}
+
+template <typename T>
+void ToonMouth1::render(T *canvas, BoundingRect rect, DrawContext *ctx) {
+  this->update(rect, ctx);  // update drawing cache
   uint16_t neutral_w = 0.8f * max_width_;
   uint16_t h = min_height_ + (max_height_ - min_height_) * open_ratio_;
   uint16_t w = min_width_ + (neutral_w - min_width_) * (1.0f - open_ratio_);
@@ -158,8 +180,19 @@ void ToonMouth1::draw(M5Canvas *canvas, BoundingRect rect, DrawContext *ctx) {
   }
 }
 
-void DoggyMouth::draw(M5Canvas *canvas, BoundingRect rect, DrawContext *ctx) {
-  this->update(canvas, rect, ctx);
+void ToonMouth1::draw(M5Canvas *canvas, BoundingRect rect, DrawContext *ctx) {
+  render(canvas, rect, ctx);
+}
+
+bool ToonMouth1::record(DisplayList *list, BoundingRect rect,
+                        DrawContext *ctx) {
+  render(list, rect, ctx);
+  return true;
+}
+
+template <typename T>
+void DoggyMouth::render(T *canvas, BoundingRect rect, DrawContext *ctx) {
+  this->update(rect, ctx);
 
   uint32_t h = min_height_ + (max_height_ - min_height_) * open_ratio_;
   uint32_t w = min_width_ + (max_width_ - min_width_) * (1 - open_ratio_);
@@ -176,4 +209,14 @@ void DoggyMouth::draw(M5Canvas *canvas, BoundingRect rect, DrawContext *ctx) {
   canvas->fillEllipse(center_x_ + 29, center_y_ - 4, 27, 15, skin_color_);
 }
 
+void DoggyMouth::draw(M5Canvas *canvas, BoundingRect rect, DrawContext *ctx) {
+  render(canvas, rect, ctx);
+}
+
+bool DoggyMouth::record(DisplayList *list, BoundingRect rect,
+                        DrawContext *ctx) {
+  render(list, rect, ctx);
+  return true;
+}
+
 }  // namespace m5avatar
\ No newline at end of file
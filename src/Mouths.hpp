@@ -28,7 +28,7 @@ class BaseMouth : public Drawable {
   uint16_t max_height_;
 
   // caches for drawing
-  ColorPalette *palette_;
+  const ColorPalette *palette_;
   int16_t center_x_;
   int16_t center_y_;
   uint16_t background_color_;  // mouth background
@@ -43,30 +43,51 @@ class BaseMouth : public Drawable {
             uint16_t max_height);
 
   void update(M5Canvas *canvas, BoundingRect rect, DrawContext *ctx);
+  void update(BoundingRect rect, DrawContext *ctx);
 };
 
 class RectMouth : public BaseMouth {
+ protected:
+  template <typename T>
+  void render(T *canvas, BoundingRect rect, DrawContext *ctx);
+
  public:
   using BaseMouth::BaseMouth;
   void draw(M5Canvas *canvas, BoundingRect rect, DrawContext *ctx);
+  bool record(DisplayList *list, BoundingRect rect, DrawContext *ctx);
 };
 
 class OmegaMouth : public BaseMouth {
+ protected:
+  template <typename T>
+  void render(T *canvas, BoundingRect rect, DrawContext *ctx);
+
  public:
   using BaseMouth::BaseMouth;
   void draw(M5Canvas *canvas, BoundingRect rect, DrawContext *ctx);
+  bool record(DisplayList *list, BoundingRect rect, DrawContext *ctx);
 };
 
 class ToonMouth1 : public BaseMouth {
+ protected:
+  template <typename T>
+  void render(T *canvas, BoundingRect rect, DrawContext *ctx);
+
  public:
   using BaseMouth::BaseMouth;
   void draw(M5Canvas *canvas, BoundingRect rect, DrawContext *ctx);
+  bool record(DisplayList *list, BoundingRect rect, DrawContext *ctx);
 };
 
 class DoggyMouth : public BaseMouth {
+ protected:
+  template <typename T>
+  void render(T *canvas, BoundingRect rect, DrawContext *ctx);
+
  public:
   using BaseMouth::BaseMouth;
   void draw(M5Canvas *canvas, BoundingRect rect, DrawContext *ctx);
+  bool record(DisplayList *list, BoundingRect rect, DrawContext *ctx);
 };
 
 }  // namespace m5avatar
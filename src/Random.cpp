@@ -0,0 +1,51 @@
+/**
+ * @file Random.cpp
+ * @brief seeded random numbers for facial behaviors
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "Random.hpp"
+
+namespace m5avatar {
+
+// avatars are seeded with 0, 1, 2, ... in the order they are constructed
+static_assert(Random::mixSeed(0) != Random::mixSeed(1) &&
+                  Random::mixSeed(1) != Random::mixSeed(2) &&
+                  Random::mixSeed(0) != 0 && Random::mixSeed(1) != 0,
+              "seeds of avatars must give different states");
+
+Random::Random(uint32_t seed) : state{1} { this->seed(seed); }
+
+void Random::seed(uint32_t seed) {
+  // the state of xorshift must not be 0
+  state = mixSeed(seed);
+  if (state == 0) {
+    state = 0x9e3779b9u;
+  }
+}
+
+uint32_t Random::next() {
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+uint32_t Random::below(uint32_t n) {
+  // multiply instead of modulo: no division, and the high bits are used
+  return static_cast<uint64_t>(next()) * n >> 32;
+}
+
+float Random::uniform() {
+  // 24 bits fit in the mantissa of a float
+  return (next() >> 8) * (1.0f / 16777216.0f);
+}
+
+float Random::uniform(float min, float max) {
+  return min + (max - min) * uniform();
+}
+
+}  // namespace m5avatar
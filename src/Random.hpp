@@ -0,0 +1,64 @@
+/**
+ * @file Random.hpp
+ * @brief seeded random numbers for facial behaviors
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef M5AVATAR_RANDOM_HPP_
+#define M5AVATAR_RANDOM_HPP_
+
+#include <stdint.h>
+
+namespace m5avatar {
+
+/**
+ * @brief xorshift32 generator
+ *
+ * Each avatar owns one for its behaviors, so that avatars do not share the
+ * lock of rand() and the same seed repeats the same blinks and saccades.
+ * Not thread-safe; use it from the task running the behaviors.
+ */
+class Random {
+ private:
+  uint32_t state;
+
+  static constexpr uint32_t xorShift(uint32_t z, int shift) {
+    return z ^ (z >> shift);
+  }
+
+ public:
+  /**
+   * @brief initial state of a seed (finalizer of splitmix32)
+   *
+   * The finalizer is a bijection, so different seeds give different states
+   * and avatars seeded 0, 1, 2, ... have different sequences.
+   */
+  static constexpr uint32_t mixSeed(uint32_t seed) {
+    return xorShift(
+        xorShift(xorShift(seed + 0x9e3779b9u, 16) * 0x85ebca6bu, 13) *
+            0xc2b2ae35u,
+        16);
+  }
+
+  explicit Random(uint32_t seed = 1);
+  ~Random() = default;
+  Random(const Random &other) = default;
+  Random &operator=(const Random &other) = default;
+
+  void seed(uint32_t seed);
+  uint32_t next();
+
+  // [0, n). 0 if n is 0
+  uint32_t below(uint32_t n);
+  // [0, 1)
+  float uniform();
+  // [min, max)
+  float uniform(float min, float max);
+};
+
+}  // namespace m5avatar
+
+#endif  // M5AVATAR_RANDOM_HPP_
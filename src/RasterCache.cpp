@@ -0,0 +1,284 @@
+/**
+ * @file RasterCache.cpp
+ * @brief LRU cache of rasterized face parts
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "RasterCache.hpp"
+
+#include <algorithm>
+
+namespace m5avatar {
+
+namespace {
+
+// commands of the most complex built-in part with some margin
+constexpr size_t kScratchCapacity = 32;
+
+// distinct colors of a raster searched for a key color. parts draw a few
+constexpr size_t kMaxRasterColors = 32;
+
+// color given to LGFX for a raw pixel value
+uint16_t toColor(uint32_t value, int depth) {
+  // NOTE: 16-bit sprites store RGB565 in big endian
+  return depth == 16 ? static_cast<uint16_t>((value >> 8) | (value << 8))
+                     : static_cast<uint16_t>(value);
+}
+
+}  // namespace
+
+RasterCache::RasterCache()
+    : entries{},
+      scratch{},
+      budget{0},
+      usage{0},
+      hits{0},
+      misses{0},
+      tick{0},
+      signature{0} {}
+
+RasterCache::~RasterCache() { clear(); }
+
+RasterCache::RasterCache(const RasterCache &other) : RasterCache() {
+  budget = other.budget;
+}
+
+RasterCache &RasterCache::operator=(const RasterCache &other) {
+  if (this != &other) {
+    clear();
+    budget = other.budget;
+  }
+  return *this;
+}
+
+void RasterCache::setBudget(size_t bytes) {
+  budget = bytes;
+  if (budget == 0) {
+    clear();
+    scratch.release();
+    return;
+  }
+  evict(0);
+}
+
+void RasterCache::resetStats() {
+  hits = 0;
+  misses = 0;
+}
+
+void RasterCache::clear() {
+  for (auto &entry : entries) {
+    if (entry.sprite != nullptr) {
+      entry.sprite->deleteSprite();
+      delete entry.sprite;
+    }
+  }
+  entries.clear();
+  usage = 0;
+}
+
+uint32_t RasterCache::computeSignature(DrawContext *ctx) {
+  // FNV-1a over color depth and palette
+  uint32_t hash = 2166136261u;
+  auto mix = [&hash](uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+      hash = (hash ^ ((value >> (i * 8)) & 0xFF)) * 16777619u;
+    }
+  };
+  mix(ctx->getColorDepth());
+  ColorPalette *palette = ctx->getColorPalette();
+  for (size_t i = 0; i < ColorPalette::kNumLocations; i++) {
+    DrawingLocation location = static_cast<DrawingLocation>(i);
+    mix(palette->contains(location) ? palette->get(location) : 0x10000u);
+  }
+  return hash;
+}
+
+void RasterCache::evict(size_t bytes) {
+  while (!entries.empty() && usage + bytes > budget) {
+    size_t oldest = 0;
+    for (size_t i = 1; i < entries.size(); i++) {
+      if (entries[i].lastUsed < entries[oldest].lastUsed) {
+        oldest = i;
+      }
+    }
+    Entry &entry = entries[oldest];
+    if (entry.sprite != nullptr) {
+      entry.sprite->deleteSprite();
+      delete entry.sprite;
+    }
+    usage -= entry.bytes;
+    entries[oldest] = entries.back();
+    entries.pop_back();
+  }
+}
+
+void RasterCache::push(M5Canvas *dst, const Entry &entry, int16_t anchor_x,
+                       int16_t anchor_y) {
+  if (entry.sprite == nullptr) {
+    return;  // the part draws nothing in this state
+  }
+  entry.sprite->pushSprite(dst, anchor_x + entry.x, anchor_y + entry.y,
+                           entry.transparent);
+}
+
+M5Canvas *RasterCache::rasterize(M5Canvas *dst, BoundingRect bounds,
+                                 uint16_t fill, DrawContext *ctx) {
+  int depth = ctx->getColorDepth();
+  M5Canvas *sprite = new M5Canvas();
+  sprite->setColorDepth(depth);
+  if (sprite->createSprite(bounds.getWidth(), bounds.getHeight()) ==
+      nullptr) {
+    delete sprite;
+    return nullptr;
+  }
+  if (depth == 8 && dst->hasPalette()) {
+    // indexed frame. see Face::setIndexedColorDepth()
+    sprite->createPalette();
+  }
+  ColorPalette *palette = ctx->getColorPalette();
+  // NOTE: same palette as the frame sprite for 1-bit color depth
+  sprite->setBitmapColor(palette->get(COLOR_PRIMARY),
+                         palette->get(COLOR_BACKGROUND));
+  sprite->fillSprite(fill);
+  scratch.render(sprite, bounds, bounds.getTop(), bounds.getLeft());
+  return sprite;
+}
+
+bool RasterCache::applyKey(M5Canvas *dst, M5Canvas *sprite,
+                           BoundingRect bounds, uint16_t background,
+                           DrawContext *ctx, uint16_t *key) {
+  int depth = ctx->getColorDepth();
+  if (depth != 1 && depth != 2 && depth != 4 && depth != 8 && depth != 16) {
+    return false;
+  }
+  // pixels not drawn by the part differ between two fills
+  M5Canvas *probe = rasterize(dst, bounds, background ^ 1, ctx);
+  if (probe == nullptr) {
+    return false;
+  }
+  std::vector<uint32_t> colors;
+  bool keyed = true;
+  for (int32_t y = 0; keyed && y < bounds.getHeight(); y++) {
+    for (int32_t x = 0; x < bounds.getWidth(); x++) {
+      uint32_t value = sprite->readPixelValue(x, y);
+      if (value != probe->readPixelValue(x, y) ||
+          std::find(colors.begin(), colors.end(), value) != colors.end()) {
+        continue;
+      }
+      if (colors.size() >= kMaxRasterColors) {
+        keyed = false;
+        break;
+      }
+      colors.push_back(value);
+    }
+  }
+  // the least value not drawn
+  uint32_t value = 0;
+  while (keyed && std::find(colors.begin(), colors.end(), value) !=
+                      colors.end()) {
+    value++;
+  }
+  keyed = keyed && value < (1u << depth);
+  if (keyed) {
+    *key = toColor(value, depth);
+    for (int32_t y = 0; y < bounds.getHeight(); y++) {
+      for (int32_t x = 0; x < bounds.getWidth(); x++) {
+        if (sprite->readPixelValue(x, y) != probe->readPixelValue(x, y)) {
+          sprite->drawPixel(x, y, *key);
+        }
+      }
+    }
+  }
+  probe->deleteSprite();
+  delete probe;
+  return keyed;
+}
+
+bool RasterCache::draw(M5Canvas *dst, uint32_t key, int16_t anchor_x,
+                       int16_t anchor_y, DrawContext *ctx) {
+  if (!isEnabled()) {
+    return false;
+  }
+  uint32_t current = computeSignature(ctx);
+  if (current != signature) {
+    clear();
+    signature = current;
+  }
+  for (auto &entry : entries) {
+    if (entry.key == key) {
+      entry.lastUsed = ++tick;
+      if (entry.direct) {
+        // store() draws the recorded list
+        return false;
+      }
+      hits++;
+      push(dst, entry, anchor_x, anchor_y);
+      return true;
+    }
+  }
+  misses++;
+  return false;
+}
+
+DisplayList *RasterCache::record() {
+  scratch.reserve(kScratchCapacity, 0);
+  scratch.clear();
+  return &scratch;
+}
+
+void RasterCache::store(M5Canvas *dst, uint32_t key, int16_t anchor_x,
+                        int16_t anchor_y, DrawContext *ctx) {
+  BoundingRect frame(0, 0, dst->width(), dst->height());
+  // floodFill depends on pixels of the frame, so it cannot be cached
+  if (scratch.isOverflowed() || scratch.hasUnboundedCommand()) {
+    scratch.render(dst, frame);
+    return;
+  }
+  for (auto &entry : entries) {
+    if (entry.key == key && entry.direct) {
+      scratch.render(dst, frame);
+      return;
+    }
+  }
+  BoundingRect bounds = scratch.getBounds();
+  int depth = ctx->getColorDepth();
+  Entry entry{key, nullptr, 0, 0, 0, false, 0, ++tick};
+  if (bounds.getWidth() > 0 && bounds.getHeight() > 0) {
+    size_t bytes =
+        ((bounds.getWidth() * depth + 7) / 8) * bounds.getHeight();
+    if (bytes > budget) {
+      scratch.render(dst, frame);
+      return;
+    }
+    evict(bytes);
+    uint16_t background =
+        depth == 1 ? 0 : ctx->getColorPalette()->get(COLOR_BACKGROUND);
+    M5Canvas *sprite = rasterize(dst, bounds, background, ctx);
+    if (sprite == nullptr) {
+      M5_LOGE("failed to allocate a raster cache sprite");
+      scratch.render(dst, frame);
+      return;
+    }
+    if (applyKey(dst, sprite, bounds, background, ctx, &entry.transparent)) {
+      entry.sprite = sprite;
+      entry.x = bounds.getLeft() - anchor_x;
+      entry.y = bounds.getTop() - anchor_y;
+      entry.bytes = sprite->bufferLength();
+    } else {
+      // remembered, so that the state is not rasterized again
+      sprite->deleteSprite();
+      delete sprite;
+      entry.direct = true;
+      scratch.render(dst, frame);
+    }
+  }
+  usage += entry.bytes;
+  entries.push_back(entry);
+  push(dst, entry, anchor_x, anchor_y);
+}
+
+}  // namespace m5avatar
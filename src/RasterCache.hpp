@@ -0,0 +1,134 @@
+/**
+ * @file RasterCache.hpp
+ * @brief LRU cache of rasterized face parts
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef M5AVATAR_RASTER_CACHE_HPP_
+#define M5AVATAR_RASTER_CACHE_HPP_
+
+#include <M5GFX.h>
+
+#include <vector>
+
+#include "DisplayList.hpp"
+#include "DrawContext.h"
+
+namespace m5avatar {
+
+/**
+ * @brief cache of small sprites holding rasterized parts
+ *
+ * A part records its drawing into the scratch list returned by record(). The
+ * list is rasterized into a sprite as large as the bounds of the list. Pixels
+ * the part does not draw are filled with a key color the part never draws,
+ * and the sprite is pushed into the frame with the key as transparent. So
+ * the part paints over the frame as drawing it directly does, masks in the
+ * background color included. The next frame with the same key pushes the
+ * sprite without drawing. A state drawing every color of the depth (e.g.
+ * both colors of 1-bit) leaves no key, and its list is drawn directly.
+ *
+ * Sprites are placed relative to an anchor (center of the part), so a part
+ * moved by breath still hits the cache. Keys are given by the part and must
+ * contain every state which changes the drawing. Colors and color depth are
+ * checked by the cache itself; all sprites are dropped when they change.
+ *
+ * The cache is disabled until a byte budget is set. When the budget is
+ * exceeded, the least recently used sprites are deleted.
+ */
+class RasterCache {
+ private:
+  struct Entry {
+    uint32_t key;
+    M5Canvas *sprite;
+    // position of the sprite relative to the anchor
+    int16_t x;
+    int16_t y;
+    // color of the pixels the part does not draw
+    uint16_t transparent;
+    // no key color is left. the part draws the list into the frame
+    bool direct;
+    size_t bytes;
+    uint32_t lastUsed;
+  };
+  std::vector<Entry> entries;
+  DisplayList scratch;
+  size_t budget;
+  size_t usage;
+  uint32_t hits;
+  uint32_t misses;
+  uint32_t tick;
+  // signature of colors and color depth the sprites are drawn with
+  uint32_t signature;
+
+  static uint32_t computeSignature(DrawContext *ctx);
+  void evict(size_t bytes);
+  M5Canvas *rasterize(M5Canvas *dst, BoundingRect bounds, uint16_t fill,
+                      DrawContext *ctx);
+  bool applyKey(M5Canvas *dst, M5Canvas *sprite, BoundingRect bounds,
+                uint16_t background, DrawContext *ctx, uint16_t *key);
+  void push(M5Canvas *dst, const Entry &entry, int16_t anchor_x,
+            int16_t anchor_y);
+
+ public:
+  RasterCache();
+  ~RasterCache();
+  // sprites are not shared. a copy has the same budget and no sprites
+  RasterCache(const RasterCache &other);
+  RasterCache &operator=(const RasterCache &other);
+
+  /**
+   * @brief set the byte budget of sprites
+   *
+   * @param bytes max bytes of sprite buffers. 0 disables the cache
+   */
+  void setBudget(size_t bytes);
+  size_t getBudget() const { return budget; }
+  size_t getUsage() const { return usage; }
+  size_t getEntryCount() const { return entries.size(); }
+  bool isEnabled() const { return budget > 0; }
+
+  uint32_t getHits() const { return hits; }
+  uint32_t getMisses() const { return misses; }
+  void resetStats();
+
+  /**
+   * @brief delete all sprites
+   */
+  void clear();
+
+  /**
+   * @brief push the cached raster of a key
+   *
+   * @param dst frame sprite
+   * @param key state of the part
+   * @param anchor_x anchor in frame coordinates
+   * @param anchor_y anchor in frame coordinates
+   * @param ctx context of the frame
+   * @return true when the key was cached and pushed. false for a state drawn
+   * directly
+   */
+  bool draw(M5Canvas *dst, uint32_t key, int16_t anchor_x, int16_t anchor_y,
+            DrawContext *ctx);
+
+  /**
+   * @brief cleared list to record the part after a miss of draw()
+   */
+  DisplayList *record();
+
+  /**
+   * @brief rasterize the recorded list, cache it and push it
+   *
+   * When the raster does not fit in the budget, the list is rendered into the
+   * frame directly.
+   */
+  void store(M5Canvas *dst, uint32_t key, int16_t anchor_x, int16_t anchor_y,
+             DrawContext *ctx);
+};
+
+}  // namespace m5avatar
+
+#endif  // M5AVATAR_RASTER_CACHE_HPP_
@@ -0,0 +1,193 @@
+/**
+ * @file RenderScheduler.cpp
+ * @brief one draw task shared by several avatars
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "RenderScheduler.hpp"
+
+#include "Avatar.h"
+#include "TraceRecorder.hpp"
+
+namespace m5avatar {
+
+namespace {
+
+TaskResult_t renderLoop(void *args) {
+  RenderScheduler *scheduler = reinterpret_cast<RenderScheduler *>(args);
+  scheduler->loop();
+#ifdef SDL_h_
+  return 0;
+#else
+  vTaskDelete(NULL);
+#endif
+}
+
+}  // namespace
+
+constexpr size_t RenderScheduler::kMaxAvatars;
+
+RenderScheduler::RenderScheduler()
+    : slots{},
+      drawing{nullptr},
+      lock{},
+      signal{},
+      running{false},
+      active{false} {}
+
+RenderScheduler::~RenderScheduler() { stop(); }
+
+bool RenderScheduler::add(Avatar *avatar) {
+  bool added = false;
+  lock.lock();
+  for (auto &slot : slots) {
+    if (slot.avatar == avatar) {
+      added = true;
+      break;
+    }
+  }
+  for (size_t i = 0; !added && i < kMaxAvatars; i++) {
+    if (slots[i].avatar == nullptr) {
+      slots[i].avatar = avatar;
+      slots[i].due = lgfx::millis();
+      added = true;
+    }
+  }
+  lock.unlock();
+  if (!added) {
+    M5_LOGE("too many avatars in a render scheduler");
+    return false;
+  }
+  notify();
+  return true;
+}
+
+void RenderScheduler::remove(Avatar *avatar) {
+  lock.lock();
+  for (auto &slot : slots) {
+    if (slot.avatar == avatar) {
+      slot.avatar = nullptr;
+    }
+  }
+  bool busy = drawing == avatar;
+  lock.unlock();
+  // the draw task may have taken the avatar before it was removed
+  while (busy) {
+    lgfx::delay(1);
+    lock.lock();
+    busy = drawing == avatar;
+    lock.unlock();
+  }
+}
+
+void RenderScheduler::notify() { signal.notify(); }
+
+bool RenderScheduler::start(uint32_t stack_size, UBaseType_t priority,
+                            BaseType_t core_id) {
+  if (running) {
+    return true;
+  }
+  // a task stopped just before may still be exiting
+  while (active) {
+    lgfx::delay(1);
+  }
+  running = true;
+  active = true;
+  TaskHandle_t handle = NULL;
+#ifdef SDL_h_
+  handle = SDL_CreateThreadWithStackSize(renderLoop, "renderLoop", stack_size,
+                                         this);
+  if (handle != NULL) {
+    SDL_DetachThread(handle);
+  }
+#else
+  xTaskCreateUniversal(renderLoop,   /* Function to implement the task */
+                       "renderLoop", /* Name of the task */
+                       stack_size,   /* Stack size */
+                       this,         /* Task input parameter */
+                       priority,     /* Priority of the task */
+                       &handle,      /* Task handle. */
+                       core_id);     /* Core No*/
+#endif
+  if (handle == NULL) {
+    M5_LOGE("failed to create the render task");
+    running = false;
+    active = false;
+    return false;
+  }
+  return true;
+}
+
+void RenderScheduler::stop() {
+  running = false;
+  notify();
+  // the task uses the slots and the signal until it leaves loop()
+  while (active) {
+    lgfx::delay(1);
+  }
+}
+
+uint32_t RenderScheduler::getPeriod(Avatar *avatar) {
+  uint32_t fps = avatar->getTargetFps();
+  return fps == 0 ? FrameScheduler::kUnpacedDelay : (1000 + fps / 2) / fps;
+}
+
+uint32_t RenderScheduler::runSlot(Slot *slot, Avatar *avatar, uint32_t due,
+                                  uint32_t now) {
+  if (!avatar->needsRedraw()) {
+    return TaskSignal::kForever;
+  }
+  int32_t remaining = static_cast<int32_t>(due - now);
+  if (remaining > 0) {
+    return remaining;
+  }
+  // NOTE: avatars are drawn one by one, so transfers to a shared display
+  // do not interleave
+  avatar->draw();
+  uint32_t period = getPeriod(avatar);
+  lock.lock();
+  if (slot->avatar == avatar) {
+    slot->due = now + period;
+  }
+  lock.unlock();
+  return period;
+}
+
+uint32_t RenderScheduler::run(uint32_t now) {
+  uint32_t next = TaskSignal::kForever;
+  for (auto &slot : slots) {
+    lock.lock();
+    Avatar *avatar = slot.avatar;
+    uint32_t due = slot.due;
+    // remove() waits until the avatar is released below
+    drawing = avatar;
+    lock.unlock();
+    if (avatar != nullptr) {
+      next = std::min(next, runSlot(&slot, avatar, due, now));
+    }
+    lock.lock();
+    drawing = nullptr;
+    lock.unlock();
+  }
+  return next;
+}
+
+void RenderScheduler::loop() {
+  M5AVATAR_TRACE_THREAD("renderLoop");
+  signal.bind();
+  while (running) {
+    M5AVATAR_TRACE_SCOPE("task", "renderLoop");
+    uint32_t wait = run(lgfx::millis());
+    // woken early by notify() when an avatar changed
+    signal.wait(wait);
+  }
+  // notify() after stop() must not wake the deleted task
+  signal.unbind();
+  // the last access to the scheduler. stop() returns after this
+  active = false;
+}
+
+}  // namespace m5avatar
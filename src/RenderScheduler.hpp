@@ -0,0 +1,123 @@
+/**
+ * @file RenderScheduler.hpp
+ * @brief one draw task shared by several avatars
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef M5AVATAR_RENDER_SCHEDULER_HPP_
+#define M5AVATAR_RENDER_SCHEDULER_HPP_
+
+#include <M5Unified.h>
+
+#include <atomic>
+
+#include "SpinLock.hpp"
+#include "TaskManager.hpp"
+#include "TaskSignal.hpp"
+
+namespace m5avatar {
+
+class Avatar;
+
+/**
+ * @brief draws several avatars from one task
+ *
+ * Each avatar is drawn at its own target frame rate (Avatar::setTargetFps())
+ * when its state changed. Avatars drawn on the same display must share a
+ * scheduler, so that their transfers do not interleave on the bus.
+ *
+ * @code
+ * RenderScheduler renderer;
+ * left.setRenderScheduler(&renderer);
+ * right.setRenderScheduler(&renderer);
+ * left.start();
+ * right.start();
+ * renderer.start();
+ * @endcode
+ */
+class RenderScheduler {
+ public:
+  static constexpr size_t kMaxAvatars = 4;
+
+ private:
+  struct Slot {
+    Avatar *avatar;
+    // time to draw the next frame in milliseconds
+    uint32_t due;
+  };
+  Slot slots[kMaxAvatars];
+  // avatar in draw(). remove() waits until it is drawn
+  Avatar *drawing;
+  SpinLock lock;
+  TaskSignal signal;
+  std::atomic<bool> running;
+  // the draw task is in loop(). stop() waits until it returns
+  std::atomic<bool> active;
+
+  uint32_t getPeriod(Avatar *avatar);
+  uint32_t runSlot(Slot *slot, Avatar *avatar, uint32_t due, uint32_t now);
+
+ public:
+  RenderScheduler();
+  ~RenderScheduler();
+  RenderScheduler(const RenderScheduler &other) = delete;
+  RenderScheduler &operator=(const RenderScheduler &other) = delete;
+
+  /**
+   * @brief draw the avatar from this scheduler. called by Avatar::start()
+   *
+   * @return false if too many avatars are added
+   */
+  bool add(Avatar *avatar);
+
+  /**
+   * @brief stop drawing the avatar. called by Avatar::stop()
+   *
+   * Waits until the avatar is not being drawn, so that it can be destroyed
+   * after this returns. Do not call this from the draw task.
+   */
+  void remove(Avatar *avatar);
+
+  /**
+   * @brief wake the draw task. called when the state of an avatar changed
+   */
+  void notify();
+
+  /**
+   * @brief start the draw task
+   *
+   * @param stack_size stack size of the task
+   * @param priority priority of the task
+   * @param core_id core to run the task on
+   * @return false if the task cannot be created
+   */
+  bool start(uint32_t stack_size = 4096, UBaseType_t priority = 1,
+             BaseType_t core_id = APP_CPU_NUM);
+
+  /**
+   * @brief stop the draw task and wait until it exits
+   *
+   * Called by the destructor. Do not call this from the draw task.
+   */
+  void stop();
+  bool isRunning() const { return running; }
+
+  /**
+   * @brief draw avatars which are due
+   *
+   * @param now current time in milliseconds
+   * @return milliseconds until the next avatar is due, or TaskSignal::kForever
+   * when no avatar has to be drawn
+   */
+  uint32_t run(uint32_t now);
+
+  // body of the draw task
+  void loop();
+};
+
+}  // namespace m5avatar
+
+#endif  // M5AVATAR_RENDER_SCHEDULER_HPP_
@@ -0,0 +1,104 @@
+/**
+ * @file SeqLock.hpp
+ * @brief sequence lock to share a small state between tasks
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef M5AVATAR_SEQ_LOCK_HPP_
+#define M5AVATAR_SEQ_LOCK_HPP_
+
+#include <M5Unified.h>
+
+#include <atomic>
+
+#include "SpinLock.hpp"
+
+namespace m5avatar {
+
+/**
+ * @brief sequence lock
+ *
+ * Readers copy the value without blocking writers and retry while a write is
+ * in progress, so a reader always gets a value written by a single write.
+ * Writers are serialized by a short critical section which only covers the
+ * copy of the value.
+ *
+ * @tparam T trivially copyable value
+ */
+template <typename T>
+class SeqLock {
+ private:
+  // odd while a write is in progress
+  std::atomic<uint32_t> sequence;
+  T value;
+  // serializes writers
+  SpinLock writing;
+
+ public:
+  explicit SeqLock(const T &initial) : sequence{0}, value(initial) {}
+  ~SeqLock() = default;
+  SeqLock(const SeqLock &other) : sequence{0}, value(other.load()) {}
+  SeqLock &operator=(const SeqLock &other) {
+    if (this != &other) {
+      store(other.load());
+    }
+    return *this;
+  }
+
+  /**
+   * @brief consistent copy of the value
+   */
+  T load() const {
+    T copy;
+    uint32_t begin;
+    uint32_t end;
+    do {
+      begin = sequence.load(std::memory_order_acquire);
+      copy = value;
+      std::atomic_thread_fence(std::memory_order_acquire);
+      end = sequence.load(std::memory_order_relaxed);
+    } while ((begin & 1u) != 0 || begin != end);
+    return copy;
+  }
+
+  /**
+   * @brief number of writes so far
+   *
+   * Compare versions to find whether the value changed since it was loaded.
+   * Read the version before load().
+   */
+  uint32_t getVersion() const {
+    return sequence.load(std::memory_order_acquire) >> 1;
+  }
+
+  void store(const T &next) {
+    writing.lock();
+    sequence.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    value = next;
+    sequence.fetch_add(1, std::memory_order_release);
+    writing.unlock();
+  }
+
+  /**
+   * @brief change a part of the value
+   *
+   * @param f function called with the value to modify. keep it short
+   */
+  template <typename F>
+  void modify(F f) {
+    writing.lock();
+    sequence.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    f(value);
+    sequence.fetch_add(1, std::memory_order_release);
+    writing.unlock();
+  }
+};
+
+}  // namespace m5avatar
+
+#endif  // M5AVATAR_SEQ_LOCK_HPP_
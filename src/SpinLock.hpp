@@ -0,0 +1,61 @@
+/**
+ * @file SpinLock.hpp
+ * @brief short critical section shared by tasks
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef M5AVATAR_SPIN_LOCK_HPP_
+#define M5AVATAR_SPIN_LOCK_HPP_
+
+#include <M5Unified.h>
+
+#include <atomic>
+
+#include "TraceRecorder.hpp"
+
+namespace m5avatar {
+
+/**
+ * @brief lock for a few instructions, e.g. copying a small value
+ *
+ * Do not call blocking functions while the lock is held.
+ */
+class SpinLock {
+ private:
+#ifdef SDL_h_
+  std::atomic_flag flag = ATOMIC_FLAG_INIT;
+#else
+  portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+#endif
+
+ public:
+  SpinLock() = default;
+  ~SpinLock() = default;
+  SpinLock(const SpinLock &other) = delete;
+  SpinLock &operator=(const SpinLock &other) = delete;
+
+#ifdef SDL_h_
+  void lock() {
+    if (!flag.test_and_set(std::memory_order_acquire)) {
+      return;
+    }
+    // contended. visible in traces
+    M5AVATAR_TRACE_SCOPE("lock", "SpinLock::lock");
+    while (flag.test_and_set(std::memory_order_acquire)) {
+    }
+  }
+  void unlock() { flag.clear(std::memory_order_release); }
+#else
+  // NOTE: the critical section also keeps the owner from being preempted by
+  // another task on the same core
+  void lock() { portENTER_CRITICAL(&mux); }
+  void unlock() { portEXIT_CRITICAL(&mux); }
+#endif
+};
+
+}  // namespace m5avatar
+
+#endif  // M5AVATAR_SPIN_LOCK_HPP_
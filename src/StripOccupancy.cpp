@@ -0,0 +1,101 @@
+#include "StripOccupancy.hpp"
+
+namespace m5avatar {
+
+StripOccupancy::StripOccupancy()
+    : occupied{},
+      stripHeight{0},
+      pattern{0, 0, 0},
+      patternLength{1},
+      backgroundColor{0} {}
+
+void StripOccupancy::captureBackground(M5Canvas *canvas, uint8_t bits) {
+  auto buffer = static_cast<const uint8_t *>(canvas->getBuffer());
+  if (buffer == nullptr) {
+    return;
+  }
+  // NOTE: pixels smaller than a byte fill the whole byte with the same bits
+  patternLength = bits > 8 ? bits >> 3 : 1;
+  for (uint8_t i = 0; i < patternLength; i++) {
+    pattern[i] = buffer[i];
+  }
+  backgroundColor = canvas->readPixel(0, 0);
+}
+
+void StripOccupancy::scan(M5Canvas *canvas, uint8_t bits,
+                          uint8_t strip_height) {
+  auto buffer = static_cast<const uint8_t *>(canvas->getBuffer());
+  int32_t width = canvas->width();
+  int32_t height = canvas->height();
+  stripHeight = strip_height;
+  if (buffer == nullptr || stripHeight == 0) {
+    occupied.clear();
+    return;
+  }
+  occupied.assign((height + stripHeight - 1) / stripHeight, true);
+
+  uint32_t stride = (width * bits + 7) >> 3;
+  for (size_t k = 0; k < occupied.size(); k++) {
+    int32_t y0 = k * stripHeight;
+    int32_t y1 = std::min<int32_t>(height, y0 + stripHeight);
+    bool found = false;
+    for (int32_t y = y0; y < y1 && !found; y++) {
+      const uint8_t *p = buffer + y * stride;
+      for (uint32_t i = 0; i < stride; i++) {
+        if (p[i] != pattern[i % patternLength]) {
+          found = true;
+          break;
+        }
+      }
+    }
+    occupied[k] = found;
+  }
+}
+
+void StripOccupancy::scan(const DisplayList &list, int16_t height,
+                          uint8_t strip_height) {
+  stripHeight = strip_height;
+  if (stripHeight == 0) {
+    occupied.clear();
+    return;
+  }
+  occupied.assign((height + stripHeight - 1) / stripHeight, false);
+  for (size_t i = 0; i < list.size(); i++) {
+    const DisplayCommand &c = list[i];
+    if (c.type == DisplayCommandType::kClip || c.right <= c.left ||
+        c.bottom <= c.top) {
+      continue;
+    }
+    int32_t first = std::max<int32_t>(0, c.top) / stripHeight;
+    int32_t last = std::min<int32_t>(
+        occupied.size(),
+        (std::max<int32_t>(0, c.bottom) + stripHeight - 1) / stripHeight);
+    for (int32_t k = first; k < last; k++) {
+      occupied[k] = true;
+    }
+  }
+}
+
+void StripOccupancy::setBackgroundColor(uint16_t color) {
+  backgroundColor = color;
+}
+
+bool StripOccupancy::isOccupied(int16_t top, int16_t bottom) {
+  if (stripHeight == 0 || occupied.empty()) {
+    // unknown
+    return true;
+  }
+  int32_t first = std::max<int32_t>(0, top) / stripHeight;
+  int32_t last = (std::max<int32_t>(0, bottom) + stripHeight - 1) / stripHeight;
+  last = std::min<int32_t>(last, occupied.size());
+  for (int32_t k = first; k < last; k++) {
+    if (occupied[k]) {
+      return true;
+    }
+  }
+  return false;
+}
+
+uint16_t StripOccupancy::getBackgroundColor() { return backgroundColor; }
+
+}  // namespace m5avatar
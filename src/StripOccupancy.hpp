@@ -0,0 +1,92 @@
+/**
+ * @file StripOccupancy.hpp
+ * @brief find strips of a frame sprite which contain only the background
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef M5AVATAR_STRIP_OCCUPANCY_HPP_
+#define M5AVATAR_STRIP_OCCUPANCY_HPP_
+
+#include <M5GFX.h>
+
+#include <vector>
+
+#include "DisplayList.hpp"
+
+namespace m5avatar {
+
+/**
+ * @brief occupancy of strips (rows) of a frame sprite
+ *
+ * A strip is occupied when it has any pixel other than the background.
+ */
+class StripOccupancy {
+ private:
+  std::vector<bool> occupied;
+  uint8_t stripHeight;
+  // raw bytes of a background pixel in the sprite buffer
+  uint8_t pattern[3];
+  uint8_t patternLength;
+  // background color in RGB565 as it appears on the display
+  uint16_t backgroundColor;
+
+ public:
+  StripOccupancy();
+  ~StripOccupancy() = default;
+  StripOccupancy(const StripOccupancy &other) = default;
+  StripOccupancy &operator=(const StripOccupancy &other) = default;
+  // moved without allocation, e.g. swapped between frame buffers
+  StripOccupancy(StripOccupancy &&other) = default;
+  StripOccupancy &operator=(StripOccupancy &&other) = default;
+
+  /**
+   * @brief remember the background of the sprite
+   *
+   * Call this right after the sprite is filled with the background.
+   *
+   * @param canvas frame sprite
+   * @param bits color depth of the sprite in bits per pixel
+   */
+  void captureBackground(M5Canvas *canvas, uint8_t bits);
+
+  /**
+   * @brief scan the sprite and update occupancy of each strip
+   *
+   * @param canvas frame sprite
+   * @param bits color depth of the sprite in bits per pixel
+   * @param strip_height height of strips in pixels
+   */
+  void scan(M5Canvas *canvas, uint8_t bits, uint8_t strip_height);
+
+  /**
+   * @brief update occupancy of each strip from bounds of commands
+   *
+   * Commands drawn with the background color count as occupied.
+   *
+   * @param list display list of the frame
+   * @param height height of the frame in pixels
+   * @param strip_height height of strips in pixels
+   */
+  void scan(const DisplayList &list, int16_t height, uint8_t strip_height);
+
+  /**
+   * @brief set the background color when no sprite is captured
+   *
+   * @param color background color in RGB565
+   */
+  void setBackgroundColor(uint16_t color);
+
+  /**
+   * @brief check if any row in [top, bottom) is occupied
+   */
+  bool isOccupied(int16_t top, int16_t bottom);
+
+  uint16_t getBackgroundColor();
+};
+
+}  // namespace m5avatar
+
+#endif  // M5AVATAR_STRIP_OCCUPANCY_HPP_
@@ -0,0 +1,304 @@
+/**
+ * @file TaskManager.cpp
+ * @brief registry of tasks run by an avatar
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "TaskManager.hpp"
+
+#include <cstring>
+
+#include "Avatar.h"
+
+#if !defined(SDL_h_) && defined(configGENERATE_RUN_TIME_STATS) && \
+    defined(configUSE_TRACE_FACILITY)
+#if configGENERATE_RUN_TIME_STATS == 1 && configUSE_TRACE_FACILITY == 1
+#define M5AVATAR_TASK_RUN_TIME_STATS
+#endif
+#endif
+
+namespace m5avatar {
+
+constexpr size_t TaskInfo::kMaxNameLength;
+constexpr size_t TaskManager::kMaxTasks;
+
+TaskManager::TaskManager()
+    : entries{}, queries{0}, lastTotalRunTime{0}, lock{} {}
+
+TaskManager::~TaskManager() {
+  for (size_t i = 0; i < kMaxTasks; i++) {
+    lock.lock();
+    Entry entry = entries[i];
+    entries[i].used = false;
+    lock.unlock();
+    if (entry.used) {
+      release(entry, true);
+    }
+  }
+}
+
+TaskManager::TaskManager(const TaskManager &other) : TaskManager() {}
+
+TaskManager &TaskManager::operator=(const TaskManager &other) {
+  return *this;
+}
+
+int TaskManager::find(const char *name) const {
+  for (size_t i = 0; i < kMaxTasks; i++) {
+    if (entries[i].used &&
+        strncmp(entries[i].name, name, TaskInfo::kMaxNameLength - 1) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+TaskHandle_t TaskManager::add(TaskFunction_t f, const char *name,
+                              uint32_t stack_size, UBaseType_t priority,
+                              BaseType_t core_id, DriveContext *ctx) {
+  // reserve a slot before creating the task, so that the name stays unique
+  lock.lock();
+  int index = -1;
+  if (find(name) < 0) {
+    for (size_t i = 0; i < kMaxTasks; i++) {
+      if (!entries[i].used && !entries[i].removing) {
+        index = i;
+        break;
+      }
+    }
+  }
+  if (index >= 0) {
+    Entry &entry = entries[index];
+    strncpy(entry.name, name, TaskInfo::kMaxNameLength - 1);
+    entry.name[TaskInfo::kMaxNameLength - 1] = '\0';
+    entry.handle = NULL;
+    entry.ctx = ctx;
+    entry.stackSize = stack_size;
+    entry.lastRunTime = 0;
+    entry.used = true;
+  }
+  lock.unlock();
+  if (index < 0) {
+    M5_LOGE("cannot add task %s: the name is taken or too many tasks", name);
+    delete ctx;
+    return NULL;
+  }
+
+  TaskHandle_t handle = NULL;
+#ifdef SDL_h_
+  handle = SDL_CreateThreadWithStackSize(f, name, stack_size, ctx);
+#else
+  xTaskCreateUniversal(f,          /* Function to implement the task */
+                       name,       /* Name of the task */
+                       stack_size, /* Stack size */
+                       ctx,        /* Task input parameter */
+                       priority,   /* Priority of the task */
+                       &handle,    /* Task handle. */
+                       core_id);   /* Core No*/
+#endif
+  if (handle == NULL) {
+    M5_LOGE("failed to create task %s", name);
+    lock.lock();
+    entries[index].used = false;
+    lock.unlock();
+    delete ctx;
+    return NULL;
+  }
+  lock.lock();
+  // the task may have exited already
+  if (entries[index].used && entries[index].ctx == ctx) {
+    entries[index].handle = handle;
+  }
+  lock.unlock();
+  return handle;
+}
+
+int TaskManager::take(const char *name, Entry *entry) {
+  // NOTE: call with the lock held. only one caller gets the entry
+  int index = find(name);
+  if (index >= 0) {
+    *entry = entries[index];
+    entries[index].used = false;
+  }
+  return index;
+}
+
+void TaskManager::waitForQueries() {
+  lock.lock();
+  bool busy = queries != 0;
+  lock.unlock();
+  while (busy) {
+    lgfx::delay(1);
+    lock.lock();
+    busy = queries != 0;
+    lock.unlock();
+  }
+}
+
+void TaskManager::release(const Entry &entry, bool delete_task) {
+  // getTasks() may be reading the task copied before it was taken
+  waitForQueries();
+  delete entry.ctx;
+  if (entry.handle == NULL) {
+    return;
+  }
+#ifdef SDL_h_
+  if (delete_task) {
+    M5_LOGW("thread %s keeps running. SDL cannot stop it", entry.name);
+  }
+  SDL_DetachThread(entry.handle);
+#else
+  if (delete_task) {
+    // NOTE: does not return when the task removes itself
+    vTaskDelete(entry.handle == xTaskGetCurrentTaskHandle() ? NULL
+                                                            : entry.handle);
+  }
+#endif
+}
+
+bool TaskManager::remove(const char *name) {
+  Entry entry;
+  lock.lock();
+  int index = take(name, &entry);
+#ifndef SDL_h_
+  // a task removing itself does not return from release()
+  bool removing = index >= 0 && entry.handle != NULL &&
+                  entry.handle != xTaskGetCurrentTaskHandle();
+#else
+  bool removing = false;
+#endif
+  if (removing) {
+    entries[index].removing = true;
+  }
+  lock.unlock();
+  if (index < 0) {
+    return false;
+  }
+  release(entry, true);
+  if (removing) {
+    lock.lock();
+    entries[index].removing = false;
+    lock.unlock();
+  }
+  return true;
+}
+
+void TaskManager::exit(const char *name) {
+  Entry entry;
+  lock.lock();
+  int index = take(name, &entry);
+  bool removed = false;
+  for (size_t i = 0; index < 0 && i < kMaxTasks; i++) {
+    if (entries[i].removing &&
+        strncmp(entries[i].name, name, TaskInfo::kMaxNameLength - 1) == 0) {
+      removed = true;
+    }
+  }
+  lock.unlock();
+  if (index >= 0) {
+    release(entry, false);
+    return;
+  }
+  // remove() holds the handle of this task. the task must not delete itself
+  // before remove() deletes it
+  while (removed) {
+    lgfx::delay(1);
+  }
+}
+
+TaskHandle_t TaskManager::getHandle(const char *name) const {
+  lock.lock();
+  int index = find(name);
+  TaskHandle_t handle = index < 0 ? NULL : entries[index].handle;
+  lock.unlock();
+  return handle;
+}
+
+bool TaskManager::contains(const char *name) const {
+  lock.lock();
+  bool found = find(name) >= 0;
+  lock.unlock();
+  return found;
+}
+
+bool TaskManager::isCurrent() const {
+#ifdef SDL_h_
+  SDL_threadID current = SDL_ThreadID();
+#else
+  TaskHandle_t current = xTaskGetCurrentTaskHandle();
+#endif
+  bool found = false;
+  lock.lock();
+  for (size_t i = 0; i < kMaxTasks && !found; i++) {
+    const Entry &entry = entries[i];
+    if (!entry.used || entry.handle == NULL) {
+      continue;
+    }
+#ifdef SDL_h_
+    found = SDL_GetThreadID(entry.handle) == current;
+#else
+    found = entry.handle == current;
+#endif
+  }
+  lock.unlock();
+  return found;
+}
+
+std::vector<TaskInfo> TaskManager::getTasks() {
+  Entry copy[kMaxTasks];
+  lock.lock();
+  memcpy(copy, entries, sizeof(copy));
+  // the copied tasks stay alive until the count is decreased
+  queries++;
+  lock.unlock();
+
+#ifdef M5AVATAR_TASK_RUN_TIME_STATS
+  std::vector<TaskStatus_t> statuses(uxTaskGetNumberOfTasks() + 4);
+  uint32_t total = 0;
+  statuses.resize(uxTaskGetSystemState(statuses.data(), statuses.size(),
+                                       &total));
+  uint32_t elapsed = total - lastTotalRunTime;
+  lastTotalRunTime = total;
+#endif
+
+  std::vector<TaskInfo> infos;
+  for (size_t i = 0; i < kMaxTasks; i++) {
+    const Entry &entry = copy[i];
+    if (!entry.used || entry.handle == NULL) {
+      continue;
+    }
+    TaskInfo info;
+    memcpy(info.name, entry.name, sizeof(info.name));
+    info.handle = entry.handle;
+    info.stackSize = entry.stackSize;
+    info.stackHighWaterMark = 0;
+    info.cpuUsage = -1.0f;
+#ifndef SDL_h_
+    info.stackHighWaterMark = uxTaskGetStackHighWaterMark(entry.handle);
+#endif
+#ifdef M5AVATAR_TASK_RUN_TIME_STATS
+    for (const auto &status : statuses) {
+      if (status.xHandle != entry.handle) {
+        continue;
+      }
+      uint32_t run_time = status.ulRunTimeCounter - entry.lastRunTime;
+      info.cpuUsage = elapsed == 0 ? 0.0f : 100.0f * run_time / elapsed;
+      lock.lock();
+      if (entries[i].used && entries[i].handle == entry.handle) {
+        entries[i].lastRunTime = status.ulRunTimeCounter;
+      }
+      lock.unlock();
+    }
+#endif
+    infos.push_back(info);
+  }
+  lock.lock();
+  queries--;
+  lock.unlock();
+  return infos;
+}
+
+}  // namespace m5avatar
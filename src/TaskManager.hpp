@@ -0,0 +1,137 @@
+/**
+ * @file TaskManager.hpp
+ * @brief registry of tasks run by an avatar
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef M5AVATAR_TASK_MANAGER_HPP_
+#define M5AVATAR_TASK_MANAGER_HPP_
+
+#include <M5Unified.h>
+
+#include <vector>
+
+#include "SpinLock.hpp"
+
+#ifdef SDL_h_
+typedef SDL_ThreadFunction TaskFunction_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef SDL_Thread *TaskHandle_t;
+typedef int TaskResult_t;
+#define PRO_CPU_NUM (0)
+#define APP_CPU_NUM (1)
+#else
+typedef void TaskResult_t;
+#endif
+
+#ifndef APP_CPU_NUM
+#define APP_CPU_NUM PRO_CPU_NUM
+#endif
+
+namespace m5avatar {
+
+class DriveContext;
+
+/**
+ * @brief statistics of a task
+ */
+struct TaskInfo {
+  static constexpr size_t kMaxNameLength = 16;
+  char name[kMaxNameLength];
+  TaskHandle_t handle;
+  // in the unit of xTaskCreate (bytes on ESP-IDF)
+  uint32_t stackSize;
+  // the least free stack so far. 0 when unknown, e.g. on SDL
+  uint32_t stackHighWaterMark;
+  // percentage of the time of one core since the last getTasks(). negative
+  // when the FreeRTOS run time stats are disabled
+  float cpuUsage;
+};
+
+/**
+ * @brief tasks keyed by unique names
+ *
+ * The manager owns the DriveContext passed to each task and deletes it when
+ * the task is removed.
+ */
+class TaskManager {
+ public:
+  static constexpr size_t kMaxTasks = 8;
+
+ private:
+  struct Entry {
+    char name[TaskInfo::kMaxNameLength];
+    TaskHandle_t handle;
+    DriveContext *ctx;
+    uint32_t stackSize;
+    uint32_t lastRunTime;
+    bool used;
+    // remove() is deleting the task. exit() of the task waits for it
+    bool removing;
+  };
+  Entry entries[kMaxTasks];
+  // getTasks() calls reading tasks. tasks are not deleted until they finish
+  uint8_t queries;
+  uint32_t lastTotalRunTime;
+  mutable SpinLock lock;
+
+  int find(const char *name) const;
+  int take(const char *name, Entry *entry);
+  void release(const Entry &entry, bool delete_task);
+  void waitForQueries();
+
+ public:
+  TaskManager();
+  ~TaskManager();
+  // tasks are not copied
+  TaskManager(const TaskManager &other);
+  TaskManager &operator=(const TaskManager &other);
+
+  /**
+   * @brief create a task
+   *
+   * @param f function of the task
+   * @param name unique name. longer names are truncated
+   * @param stack_size stack size of the task
+   * @param priority priority of the task
+   * @param core_id core to run the task on
+   * @param ctx argument of the task, deleted with the task
+   * @return the handle, or NULL if the name is taken or the task cannot be
+   * created. ctx is deleted on failure
+   */
+  TaskHandle_t add(TaskFunction_t f, const char *name, uint32_t stack_size,
+                   UBaseType_t priority, BaseType_t core_id,
+                   DriveContext *ctx);
+
+  /**
+   * @brief delete a task
+   *
+   * Do not remove a task while it holds a resource, e.g. the draw task while
+   * drawing. Stop such tasks by their loop condition and call exit() instead.
+   * Threads cannot be deleted on SDL; they are only detached.
+   *
+   * @return false if no task has the name
+   */
+  bool remove(const char *name);
+
+  /**
+   * @brief unregister a task which returns by itself
+   *
+   * Call this from the task just before it returns.
+   */
+  void exit(const char *name);
+
+  TaskHandle_t getHandle(const char *name) const;
+  bool contains(const char *name) const;
+  // true when called from one of the tasks
+  bool isCurrent() const;
+  std::vector<TaskInfo> getTasks();
+};
+
+}  // namespace m5avatar
+
+#endif  // M5AVATAR_TASK_MANAGER_HPP_
@@ -0,0 +1,113 @@
+/**
+ * @file TaskSignal.cpp
+ * @brief wakeup of a sleeping task
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "TaskSignal.hpp"
+
+#include "TraceRecorder.hpp"
+
+namespace m5avatar {
+
+constexpr uint32_t TaskSignal::kForever;
+
+#ifdef SDL_h_
+
+TaskSignal::TaskSignal() : semaphore{SDL_CreateSemaphore(0)} {}
+
+TaskSignal::~TaskSignal() {
+  if (semaphore != nullptr) {
+    SDL_DestroySemaphore(semaphore);
+  }
+}
+
+TaskSignal::TaskSignal(const TaskSignal &other) : TaskSignal() {}
+
+TaskSignal &TaskSignal::operator=(const TaskSignal &other) { return *this; }
+
+void TaskSignal::bind() {}
+
+void TaskSignal::unbind() {}
+
+bool TaskSignal::wait(uint32_t timeout_ms) {
+  M5AVATAR_TRACE_SCOPE("sleep", "TaskSignal::wait");
+  if (semaphore == nullptr) {
+    lgfx::delay(timeout_ms == kForever ? 10 : timeout_ms);
+    return false;
+  }
+  int result = timeout_ms == kForever
+                   ? SDL_SemWait(semaphore)
+                   : SDL_SemWaitTimeout(semaphore, timeout_ms);
+  // signals sent while running are handled by this wakeup
+  while (SDL_SemTryWait(semaphore) == 0) {
+  }
+  return result == 0;
+}
+
+void TaskSignal::notify() {
+  if (semaphore != nullptr) {
+    SDL_SemPost(semaphore);
+  }
+}
+
+#else
+
+TaskSignal::TaskSignal() : task{nullptr}, senders{0}, lock{} {}
+
+TaskSignal::~TaskSignal() = default;
+
+TaskSignal::TaskSignal(const TaskSignal &other) : TaskSignal() {}
+
+TaskSignal &TaskSignal::operator=(const TaskSignal &other) { return *this; }
+
+void TaskSignal::bind() {
+  lock.lock();
+  task = xTaskGetCurrentTaskHandle();
+  lock.unlock();
+}
+
+void TaskSignal::unbind() {
+  lock.lock();
+  task = nullptr;
+  bool busy = senders != 0;
+  lock.unlock();
+  // a notify() may still hold the handle
+  while (busy) {
+    lgfx::delay(1);
+    lock.lock();
+    busy = senders != 0;
+    lock.unlock();
+  }
+}
+
+bool TaskSignal::wait(uint32_t timeout_ms) {
+  TickType_t ticks =
+      timeout_ms == kForever ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms);
+  return ulTaskNotifyTake(pdTRUE, ticks) > 0;
+}
+
+void TaskSignal::notify() {
+  lock.lock();
+  TaskHandle_t receiver = task;
+  if (receiver != nullptr) {
+    senders++;
+  }
+  lock.unlock();
+  if (receiver == nullptr) {
+    return;
+  }
+  // NOTE: not under the lock. FreeRTOS APIs must not be called in a critical
+  // section
+  xTaskNotifyGive(receiver);
+  lock.lock();
+  senders--;
+  lock.unlock();
+}
+
+#endif
+
+}  // namespace m5avatar
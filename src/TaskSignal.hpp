@@ -0,0 +1,77 @@
+/**
+ * @file TaskSignal.hpp
+ * @brief wakeup of a sleeping task
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef M5AVATAR_TASK_SIGNAL_HPP_
+#define M5AVATAR_TASK_SIGNAL_HPP_
+
+#include <M5Unified.h>
+
+#include "SpinLock.hpp"
+
+namespace m5avatar {
+
+/**
+ * @brief signal which wakes one task from a timed wait
+ *
+ * A task notification on FreeRTOS and a semaphore on SDL. Signals sent while
+ * the task is running are not lost; the next wait() returns at once.
+ */
+class TaskSignal {
+ private:
+#ifdef SDL_h_
+  SDL_sem *semaphore;
+#else
+  TaskHandle_t task;
+  // notify() calls using the task. unbind() waits for them
+  uint8_t senders;
+  SpinLock lock;
+#endif
+
+ public:
+  // wait() without a timeout
+  static constexpr uint32_t kForever = UINT32_MAX;
+
+  TaskSignal();
+  ~TaskSignal();
+  // a copy is not bound to any task
+  TaskSignal(const TaskSignal &other);
+  TaskSignal &operator=(const TaskSignal &other);
+
+  /**
+   * @brief make the calling task the receiver of the signal
+   */
+  void bind();
+
+  /**
+   * @brief stop sending the signal to the bound task
+   *
+   * Call this from the bound task before it exits, so that notify() does not
+   * wake a deleted task.
+   */
+  void unbind();
+
+  /**
+   * @brief sleep until the signal is sent
+   *
+   * Call this from the bound task.
+   *
+   * @param timeout_ms milliseconds to wait at most
+   * @return true if the signal was sent
+   */
+  bool wait(uint32_t timeout_ms = kForever);
+
+  /**
+   * @brief wake the bound task. does nothing while not bound
+   */
+  void notify();
+};
+
+}  // namespace m5avatar
+
+#endif  // M5AVATAR_TASK_SIGNAL_HPP_
@@ -0,0 +1,236 @@
+/**
+ * @file TraceRecorder.cpp
+ * @brief trace events of tasks and stages exported as Chrome trace JSON
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "TraceRecorder.hpp"
+
+#ifdef M5AVATAR_TRACE_ENABLED
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+#ifndef M5AVATAR_TRACE_CAPACITY
+#define M5AVATAR_TRACE_CAPACITY 65536
+#endif
+
+namespace m5avatar {
+
+namespace {
+
+static_assert((M5AVATAR_TRACE_CAPACITY & (M5AVATAR_TRACE_CAPACITY - 1)) == 0,
+              "M5AVATAR_TRACE_CAPACITY must be a power of two");
+
+const size_t kCapacity = M5AVATAR_TRACE_CAPACITY;
+const size_t kMaxThreads = 64;
+
+struct Event {
+  // index + 1 of the event in the slot. 0 while the slot is written
+  std::atomic<uint64_t> sequence;
+  const char *category;
+  const char *name;
+  uint64_t timestamp;  // [usec]
+  uint64_t duration;   // [usec]
+  uint16_t thread;
+  char phase;
+};
+
+// copy of an event taken by write()
+struct Record {
+  const char *category;
+  const char *name;
+  uint64_t timestamp;
+  uint64_t duration;
+  uint16_t thread;
+  char phase;
+};
+
+Event events[kCapacity];
+std::atomic<uint64_t> head{0};
+std::atomic<const char *> threadNames[kMaxThreads];
+std::atomic<uint16_t> threadCount{0};
+const char *exitPath = nullptr;
+
+const std::chrono::steady_clock::time_point kOrigin =
+    std::chrono::steady_clock::now();
+
+uint16_t currentThread() {
+  static thread_local int id = -1;
+  if (id < 0) {
+    id = threadCount.fetch_add(1);
+  }
+  return id;
+}
+
+void push(char phase, const char *category, const char *name,
+          uint64_t timestamp, uint64_t duration) {
+  uint64_t index = head.fetch_add(1, std::memory_order_relaxed);
+  Event &event = events[index & (kCapacity - 1)];
+  // readers skip the slot until the sequence is published again
+  event.sequence.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  event.category = category;
+  event.name = name;
+  event.timestamp = timestamp;
+  event.duration = duration;
+  event.thread = currentThread();
+  event.phase = phase;
+  event.sequence.store(index + 1, std::memory_order_release);
+}
+
+bool read(uint64_t index, Record *record) {
+  const Event &event = events[index & (kCapacity - 1)];
+  if (event.sequence.load(std::memory_order_acquire) != index + 1) {
+    return false;
+  }
+  record->category = event.category;
+  record->name = event.name;
+  record->timestamp = event.timestamp;
+  record->duration = event.duration;
+  record->thread = event.thread;
+  record->phase = event.phase;
+  std::atomic_thread_fence(std::memory_order_acquire);
+  // overwritten while copying
+  return event.sequence.load(std::memory_order_relaxed) == index + 1;
+}
+
+void writeString(FILE *fp, const char *s) {
+  fputc('"', fp);
+  for (; s != nullptr && *s != '\0'; s++) {
+    if (*s == '"' || *s == '\\') {
+      fputc('\\', fp);
+    }
+    fputc(*s, fp);
+  }
+  fputc('"', fp);
+}
+
+void writeOnExit() { TraceRecorder::write(exitPath); }
+
+}  // namespace
+
+bool TraceRecorder::isEnabled() { return true; }
+
+uint64_t TraceRecorder::now() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now() - kOrigin)
+      .count();
+}
+
+void TraceRecorder::setThreadName(const char *name) {
+  uint16_t thread = currentThread();
+  if (thread < kMaxThreads) {
+    threadNames[thread].store(name);
+  }
+}
+
+void TraceRecorder::complete(const char *category, const char *name,
+                             uint64_t start) {
+  push('X', category, name, start, now() - start);
+}
+
+void TraceRecorder::instant(const char *category, const char *name) {
+  push('i', category, name, now(), 0);
+}
+
+bool TraceRecorder::write(const char *path) {
+  uint64_t end = head.load(std::memory_order_acquire);
+  uint64_t begin = end > kCapacity ? end - kCapacity : 0;
+  if (end == begin) {
+    return false;
+  }
+  FILE *fp = fopen(path, "w");
+  if (fp == nullptr) {
+    M5_LOGE("cannot write the trace to %s", path);
+    return false;
+  }
+  fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+  bool first = true;
+  uint16_t threads = threadCount.load();
+  for (uint16_t i = 0; i < threads && i < kMaxThreads; i++) {
+    const char *name = threadNames[i].load();
+    fprintf(fp, "%s{\"ph\":\"M\",\"pid\":1,\"tid\":%u,"
+            "\"name\":\"thread_name\",\"args\":{\"name\":",
+            first ? "" : ",\n", static_cast<unsigned>(i));
+    if (name != nullptr) {
+      writeString(fp, name);
+    } else {
+      fprintf(fp, "\"thread %u\"", static_cast<unsigned>(i));
+    }
+    fprintf(fp, "}}");
+    first = false;
+  }
+  for (uint64_t index = begin; index < end; index++) {
+    Record record;
+    if (!read(index, &record)) {
+      continue;
+    }
+    fprintf(fp, "%s{\"ph\":\"%c\",\"pid\":1,\"tid\":%u,\"ts\":%llu,",
+            first ? "" : ",\n", record.phase,
+            static_cast<unsigned>(record.thread),
+            static_cast<unsigned long long>(record.timestamp));  // NOLINT
+    if (record.phase == 'X') {
+      fprintf(fp, "\"dur\":%llu,",
+              static_cast<unsigned long long>(record.duration));  // NOLINT
+    } else {
+      fprintf(fp, "\"s\":\"t\",");
+    }
+    fprintf(fp, "\"cat\":");
+    writeString(fp, record.category);
+    fprintf(fp, ",\"name\":");
+    writeString(fp, record.name);
+    fprintf(fp, "}");
+    first = false;
+  }
+  fprintf(fp, "\n]}\n");
+  fclose(fp);
+  return true;
+}
+
+void TraceRecorder::writeAtExit(const char *path) {
+  if (exitPath == nullptr) {
+    std::atexit(writeOnExit);
+  }
+  exitPath = path;
+}
+
+void TraceRecorder::clear() {
+  // write() skips empty slots
+  uint64_t end = head.load();
+  for (uint64_t index = end > kCapacity ? end - kCapacity : 0; index < end;
+       index++) {
+    events[index & (kCapacity - 1)].sequence.store(0);
+  }
+}
+
+}  // namespace m5avatar
+
+#else
+
+namespace m5avatar {
+
+bool TraceRecorder::isEnabled() { return false; }
+
+uint64_t TraceRecorder::now() { return 0; }
+
+void TraceRecorder::setThreadName(const char *name) {}
+
+void TraceRecorder::complete(const char *category, const char *name,
+                             uint64_t start) {}
+
+void TraceRecorder::instant(const char *category, const char *name) {}
+
+bool TraceRecorder::write(const char *path) { return false; }
+
+void TraceRecorder::writeAtExit(const char *path) {}
+
+void TraceRecorder::clear() {}
+
+}  // namespace m5avatar
+
+#endif
@@ -0,0 +1,118 @@
+/**
+ * @file TraceRecorder.hpp
+ * @brief trace events of tasks and stages exported as Chrome trace JSON
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef M5AVATAR_TRACE_RECORDER_HPP_
+#define M5AVATAR_TRACE_RECORDER_HPP_
+
+#include <M5Unified.h>
+
+// events are recorded only in the native build with M5AVATAR_TRACE defined
+#if defined(M5AVATAR_TRACE) && defined(SDL_h_)
+#define M5AVATAR_TRACE_ENABLED
+#endif
+
+namespace m5avatar {
+
+/**
+ * @brief records trace events into a lock-free ring buffer
+ *
+ * Build the native (SDL) target with M5AVATAR_TRACE defined (e.g.
+ * build_flags = -DM5AVATAR_TRACE) to record loop iterations of the tasks,
+ * each part drawn, setter calls, strip pushes, sleeps and lock contention.
+ * Otherwise the trace macros are compiled out. The buffer keeps the latest
+ * M5AVATAR_TRACE_CAPACITY events and is written as Chrome trace JSON, which
+ * chrome://tracing and https://ui.perfetto.dev open.
+ *
+ * @code
+ * TraceRecorder::writeAtExit("avatar.trace.json");
+ * @endcode
+ *
+ * Names and categories are kept as pointers. Pass string literals.
+ */
+class TraceRecorder {
+ public:
+  TraceRecorder() = delete;
+
+  // events are recorded in this build
+  static bool isEnabled();
+
+  // microseconds since the first event
+  static uint64_t now();
+
+  /**
+   * @brief name the calling thread in the trace
+   *
+   * @param name string literal, e.g. the task name
+   */
+  static void setThreadName(const char *name);
+
+  // an event from start until now on the calling thread
+  static void complete(const char *category, const char *name,
+                       uint64_t start);
+  static void instant(const char *category, const char *name);
+
+  /**
+   * @brief write the recorded events as Chrome trace JSON
+   *
+   * Events may be recorded while writing. Events overwritten during the
+   * write are skipped.
+   *
+   * @param path file to write
+   * @return false if nothing was recorded or the file cannot be written
+   */
+  static bool write(const char *path);
+
+  // write the events when the program exits
+  static void writeAtExit(const char *path);
+  static void clear();
+};
+
+#ifdef M5AVATAR_TRACE_ENABLED
+/**
+ * @brief records the rest of the scope as a complete event
+ */
+class TraceScope {
+ private:
+  const char *category;
+  const char *name;
+  uint64_t start;
+
+ public:
+  TraceScope(const char *category, const char *name)
+      : category{category}, name{name}, start{TraceRecorder::now()} {}
+  ~TraceScope() { TraceRecorder::complete(category, name, start); }
+  TraceScope(const TraceScope &other) = delete;
+  TraceScope &operator=(const TraceScope &other) = delete;
+};
+
+#define M5AVATAR_TRACE_CONCAT_(a, b) a##b
+#define M5AVATAR_TRACE_CONCAT(a, b) M5AVATAR_TRACE_CONCAT_(a, b)
+#define M5AVATAR_TRACE_SCOPE(category, name)                            \
+  ::m5avatar::TraceScope M5AVATAR_TRACE_CONCAT(trace_scope_, __LINE__)( \
+      category, name)
+#define M5AVATAR_TRACE_INSTANT(category, name) \
+  ::m5avatar::TraceRecorder::instant(category, name)
+#define M5AVATAR_TRACE_THREAD(name) \
+  ::m5avatar::TraceRecorder::setThreadName(name)
+// name of the calling function, used as a default argument
+#define M5AVATAR_TRACE_CALLER __builtin_FUNCTION()
+#else
+#define M5AVATAR_TRACE_SCOPE(category, name)
+#define M5AVATAR_TRACE_INSTANT(category, name) \
+  do {                                         \
+  } while (0)
+#define M5AVATAR_TRACE_THREAD(name) \
+  do {                              \
+  } while (0)
+#define M5AVATAR_TRACE_CALLER nullptr
+#endif
+
+}  // namespace m5avatar
+
+#endif  // M5AVATAR_TRACE_RECORDER_HPP_
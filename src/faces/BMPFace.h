@@ -17,13 +17,19 @@ namespace m5avatar
 {
 class BMPEye : public Drawable
 {
+  bool isLeft;
+
+public:
+  explicit BMPEye(bool isLeft) : isLeft{isLeft} {}
+
   void draw(M5Canvas *spi, BoundingRect rect, DrawContext *ctx)
   {
     uint16_t color = ctx->getColorDepth() == 1 ? 1 : ctx->getColorPalette()->get(COLOR_PRIMARY);
     uint16_t cx = rect.getCenterX();
     uint16_t cy = rect.getCenterY();
-    float openRatio = ctx->getEyeOpenRatio();
-    Gaze g = ctx->getGaze();
+    float openRatio =
+        isLeft ? ctx->getLeftEyeOpenRatio() : ctx->getRightEyeOpenRatio();
+    Gaze g = isLeft ? ctx->getLeftGaze() : ctx->getRightGaze();
     uint32_t offsetX = g.getHorizontal() * 3;
     uint32_t offsetY = g.getVertical() * 3;
     if (openRatio == 0) {
@@ -47,8 +53,8 @@ class BMPFace : public Face
 public:
   BMPFace()
       : Face(new Mouth(50, 90, 4, 60), new BoundingRect(148, 163),
-             new BMPEye(),
-             new BoundingRect(103, 80), new BMPEye(),
+             new BMPEye(false),
+             new BoundingRect(103, 80), new BMPEye(true),
              new BoundingRect(106, 240), new Eyeblow(15, 2, false),
              new BoundingRect(67, 96), new Eyeblow(15, 2, true),
              new BoundingRect(72, 230)) {}
@@ -15,15 +15,20 @@
 namespace m5avatar {
 class DogEye : public Drawable {
     void draw(M5Canvas *spi, BoundingRect rect, DrawContext *ctx) {
+        render(spi, rect, ctx);
+    }
+    bool record(DisplayList *list, BoundingRect rect, DrawContext *ctx) {
+        render(list, rect, ctx);
+        return true;
+    }
+    template <typename T>
+    void render(T *spi, BoundingRect rect, DrawContext *ctx) {
         uint32_t cx = rect.getCenterX();
         uint32_t cy = rect.getCenterY();
         Gaze g = ctx->getLeftGaze();
-        ColorPalette *cp = ctx->getColorPalette();
-        uint16_t primaryColor =
-            ctx->getColorDepth() == 1 ? 1 : cp->get(COLOR_PRIMARY);
-        uint16_t backgroundColor = ctx->getColorDepth() == 1
-                                       ? ERACER_COLOR
-                                       : cp->get(COLOR_BACKGROUND);
+        const ColorPalette *cp = ctx->getResolvedPalette();
+        uint16_t primaryColor = cp->get(COLOR_PRIMARY);
+        uint16_t backgroundColor = cp->get(COLOR_BACKGROUND);
         uint32_t offsetX = g.getHorizontal() * 8;
         uint32_t offsetY = g.getVertical() * 5;
         float eor = ctx->getLeftEyeOpenRatio();
@@ -58,14 +63,18 @@ class DogMouth : public Drawable {
           minHeight{minHeight},
           maxHeight{maxHeight} {}
     void draw(M5Canvas *spi, BoundingRect rect, DrawContext *ctx) {
+        render(spi, rect, ctx);
+    }
+    bool record(DisplayList *list, BoundingRect rect, DrawContext *ctx) {
+        render(list, rect, ctx);
+        return true;
+    }
+    template <typename T>
+    void render(T *spi, BoundingRect rect, DrawContext *ctx) {
         uint16_t primaryColor =
-            ctx->getColorDepth() == 1
-                ? 1
-                : ctx->getColorPalette()->get(COLOR_PRIMARY);
+            ctx->getResolvedPalette()->get(COLOR_PRIMARY);
         uint16_t backgroundColor =
-            ctx->getColorDepth() == 1
-                ? ERACER_COLOR
-                : ctx->getColorPalette()->get(COLOR_BACKGROUND);
+            ctx->getResolvedPalette()->get(COLOR_BACKGROUND);
         uint32_t cx = rect.getCenterX();
         uint32_t cy = rect.getCenterY();
         float openRatio = ctx->getMouthOpenRatio();